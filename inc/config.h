@@ -16,4 +16,52 @@
 
 #define DEBUG           1
 
+// Floating point. The core has no FPU, so float pulls soft-float and libm in
+#define PRINTF_FLOAT                    0   //%f and %e in printf, otherwise printed as '?'
+#define DS18B20_FLOAT_ACCESSOR          0   //hal_ds18b20_to_celsius() for the code that needs float
+
+// Interrupt priorities. Interrupts that use FreeRTOS FromISR API must have
+// priority value not lower than configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+#define IRQ_PRIORITY_DMA                6
+#define IRQ_PRIORITY_USART              7
+#define IRQ_PRIORITY_ONE_WIRE_TIM       5   //Must preempt everything else to keep slot timing
+
+// 1-Wire
+#define ONE_WIRE_BACKEND_USART          0   //USART2 half-duplex (TX/PA2, RX/PA3)
+#define ONE_WIRE_BACKEND_TIM            1   //TIM3 CH1 open-drain PWM + CH2 capture (PA6)
+#define ONE_WIRE_BUS_BACKEND            ONE_WIRE_BACKEND_USART
+#define ONE_WIRE_SECOND_BUS             0   //Second sensors bus on USART3 (TX/PB10, RX/PB11) read by its own task
+#define ONE_WIRE_STRONG_PULLUP          0   //P-MOSFET gate on PB0 (active low) powers parasite sensors while converting
+#define ONE_WIRE_USE_DMA                1   //Transfer bytes and blocks with DMA instead of per slot polling
+#define ONE_WIRE_DMA_MAX_BLOCK          11  //Max bytes per one DMA transfer, at least the Match ROM header with the longest read command (1 + 8 + 2)
+#define ONE_WIRE_PARALLEL_MAX_BYTES     10  //Max bytes per bus in one parallel DMA run (1 + 8 + 1 = match ROM with command)
+#define ONE_WIRE_BENCHMARK              0   //Print cycle counts of the USART baudrate switch at startup
+#define ONE_WIRE_SLOT_TIMEOUT_US        2000 //Polled slot or reset echo must come within, us
+#define ONE_WIRE_TRANSACTION_TIMEOUT_MS 100 //Interrupt or DMA driven transaction must finish within, ms
+
+// Temperature sensors
+#define TEMPERATURE_ALARM_HIGH          60  //TH, C. Sensors at or above are read by the alarm monitor
+#define TEMPERATURE_ALARM_LOW           -10 //TL, C. Sensors at or below are read by the alarm monitor
+#define TEMPERATURE_ALARM_MONITOR       0   //Read only the sensors in alarm, all sensors every TEMPERATURE_FULL_SWEEP_PERIOD cycles
+#define TEMPERATURE_FULL_SWEEP_PERIOD   12  //Monitor cycles per full read of all sensors
+#define TEMPERATURE_SWEEP_PERIOD_MS     1000 //Cycle of the temperature task, the fastest sampling of a sensor
+#define TEMPERATURE_MAX_PERIOD          16  //Cycles between reads of a stable sensor, 1 to read every sensor every cycle
+#define TEMPERATURE_SLOPE               2   //Change per cycle, 1/16 C, above which the sensor is read every cycle
+#define TEMPERATURE_SAMPLE_QUEUE_LENGTH 128 //Readings between the acquisition and the formatting task, a sweep of a full bus
+#define TEMPERATURE_TEXT_BUFFER_SIZE    512 //Bytes of text between the formatting and the transport task
+#define TEMPERATURE_RESCAN_STEPS        2   //ROMs searched per cycle to find plugged and unplugged probes, 0 to disable
+#define TEMPERATURE_ROM_CACHE           1   //Keep found ROMs in flash, boot checks them instead of full search
+#define TEMPERATURE_ROM_CACHE_ADDRESS   0x0801F800  //Last two 1K flash pages, one per bus, excluded from FLASH in STM32F103XB_FLASH.ld
+#define TEMPERATURE_ROM_CACHE_STABLE    10  //Cycles the ROMs of the bus must stay the same before the cache is rewritten
+#define TEMPERATURE_ROM_CACHE_PERIOD_MS 3600000 //Min time between rewrites of the cache page of a bus, flash endures 10k erases
+#if ONE_WIRE_SECOND_BUS
+#define DS18B20_MAX_SENSORS             88  //Sensors per bus, 42 B of table and snapshot RAM each, two buses must fit RAM_SIZE
+#else
+#define DS18B20_MAX_SENSORS             120 //Sensors per bus, the ROM cache of a bus must fit one flash page
+#endif
+
+// Memory, main checks its static allocations against the budget at compile time
+#define RAM_SIZE                        (20 * 1024) //LENGTH of RAM in STM32F103XB_FLASH.ld
+#define RAM_RESERVE                     (0x600 + 1024) //_Min_Heap_Size and _Min_Stack_Size of the linker script, kernel and driver statics
+
 #endif //_CONFIG_H_
@@ -13,7 +13,7 @@
 
 #include <stdint.h>
 #include "config.h"
-#include "..\src\utils\mini-printf.h"
+#include "../src/utils/mini-printf.h"
 
 typedef uint8_t         BOOL8;
 typedef uint16_t        BOOL16;
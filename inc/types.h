@@ -15,7 +15,10 @@ typedef enum
     RESULT_OK = 1,
     RESULT_SUCCESS,
     RESULT_FAIL,
-    RESULT_NOTHING
+    RESULT_NOTHING,
+    RESULT_TIMEOUT,     //Hardware did not answer before the deadline
+    RESULT_NO_DEVICE,   //No presence pulse on the bus
+    RESULT_BUS_ERROR    //Bus is held low or framing error
 } result_t;
 
 #endif //_TYPES_H_
@@ -0,0 +1,171 @@
+/**
+ * @file drv_dma.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief DMA1 driver implementation for stm32f103xx series
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "drv_dma.h"
+#include "stm32f103xb.h"
+#include "config.h"
+
+#define DMA_FLAGS_PER_CHANNEL   4
+#define DMA_FLAG_GIF            0x1
+#define DMA_FLAG_TCIF           0x2
+#define DMA_FLAG_HTIF           0x4
+#define DMA_FLAG_TEIF           0x8
+
+#define DMA_FLAG(channel, flag)     ((uint32_t)(flag) << ((channel) * DMA_FLAGS_PER_CHANNEL))
+
+static struct
+{
+    struct
+    {
+        drv_dma_callback_t callback;
+        void * arg;
+    } channel[DD_CHANNEL_NUM];
+} _cxt;
+
+/**
+ * @brief Get the pointer to the registers of the DMA1 channel
+ * 
+ * @param channel The channel number
+ * @return DMA_Channel_TypeDef* The pointer to the channel registers
+ */
+static DMA_Channel_TypeDef * _get_channel_registers_struct(eDrvDmaChannel_t channel)
+{
+    DMA_Channel_TypeDef * ch = 0;
+
+    switch (channel)
+    {
+        case DD_CHANNEL_1: ch = DMA1_Channel1; break;
+        case DD_CHANNEL_2: ch = DMA1_Channel2; break;
+        case DD_CHANNEL_3: ch = DMA1_Channel3; break;
+        case DD_CHANNEL_4: ch = DMA1_Channel4; break;
+        case DD_CHANNEL_5: ch = DMA1_Channel5; break;
+        case DD_CHANNEL_6: ch = DMA1_Channel6; break;
+        case DD_CHANNEL_7: ch = DMA1_Channel7; break;
+    }
+
+    return ch;
+}
+
+/**
+ * @brief Configure the channel with transfer parameters and start it
+ * 
+ * @param channel The DMA1 channel
+ * @param transfer Transfer parameters
+ * @return result_t RESULT_OK if the channel was started
+ */
+result_t drv_dma_start(eDrvDmaChannel_t channel, xDrvDmaTransfer_t * transfer)
+{
+    DMA_Channel_TypeDef * ch = _get_channel_registers_struct(channel);
+
+    if (!ch || !transfer || !transfer->count)
+    {
+        return RESULT_FAIL;
+    }
+
+    RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+    ch->CCR &= ~DMA_CCR_EN;
+    DMA1->IFCR = DMA_FLAG(channel, DMA_FLAG_GIF | DMA_FLAG_TCIF | DMA_FLAG_HTIF | DMA_FLAG_TEIF);
+
+    uint32_t ccr = (transfer->priority << DMA_CCR_PL_Pos)
+                 | (transfer->mem_size << DMA_CCR_MSIZE_Pos)
+                 | (transfer->periph_size << DMA_CCR_PSIZE_Pos);
+
+    if (transfer->direction == DD_DIR_MEM_TO_PERIPH)
+    {
+        ccr |= DMA_CCR_DIR;
+    }
+
+    if (transfer->mem_increment)
+    {
+        ccr |= DMA_CCR_MINC;
+    }
+
+    _cxt.channel[channel].callback = transfer->callback;
+    _cxt.channel[channel].arg = transfer->callback_arg;
+
+    if (transfer->callback)
+    {
+        ccr |= DMA_CCR_TCIE | DMA_CCR_TEIE;
+        NVIC_SetPriority((IRQn_Type)(DMA1_Channel1_IRQn + channel), IRQ_PRIORITY_DMA);
+        NVIC_EnableIRQ((IRQn_Type)(DMA1_Channel1_IRQn + channel));
+    }
+
+    ch->CPAR = (uint32_t) transfer->periph_addr;
+    ch->CMAR = (uint32_t) transfer->mem_addr;
+    ch->CNDTR = transfer->count;
+    ch->CCR = ccr;
+    ch->CCR |= DMA_CCR_EN;
+
+    return RESULT_OK;
+}
+
+/**
+ * @brief Disable the channel and clear its pending flags
+ * 
+ * @param channel The DMA1 channel
+ */
+void drv_dma_stop(eDrvDmaChannel_t channel)
+{
+    DMA_Channel_TypeDef * ch = _get_channel_registers_struct(channel);
+
+    ch->CCR &= ~(DMA_CCR_EN | DMA_CCR_TCIE | DMA_CCR_TEIE);
+    DMA1->IFCR = DMA_FLAG(channel, DMA_FLAG_GIF | DMA_FLAG_TCIF | DMA_FLAG_HTIF | DMA_FLAG_TEIF);
+    _cxt.channel[channel].callback = 0;
+}
+
+/**
+ * @brief Check whether the channel has finished its transfer
+ * 
+ * @param channel The DMA1 channel
+ * @return BOOL TRUE if transfer complete flag is set
+ */
+BOOL drv_dma_is_complete(eDrvDmaChannel_t channel)
+{
+    return (DMA1->ISR & DMA_FLAG(channel, DMA_FLAG_TCIF)) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Get the amount of data items the channel still has to transfer
+ * 
+ * @param channel The DMA1 channel
+ * @return uint16_t Remaining items
+ */
+uint16_t drv_dma_get_remaining(eDrvDmaChannel_t channel)
+{
+    return (uint16_t) _get_channel_registers_struct(channel)->CNDTR;
+}
+
+/**
+ * @brief Common interrupt handler for DMA1 channels
+ * 
+ * @param channel The channel that raised the interrupt
+ */
+void drv_dma_irq_handler(eDrvDmaChannel_t channel)
+{
+    uint32_t isr = DMA1->ISR;
+    result_t result = RESULT_NOTHING;
+
+    if (isr & DMA_FLAG(channel, DMA_FLAG_TEIF))
+    {
+        result = RESULT_FAIL;
+    }
+    else if (isr & DMA_FLAG(channel, DMA_FLAG_TCIF))
+    {
+        result = RESULT_OK;
+    }
+
+    DMA1->IFCR = DMA_FLAG(channel, DMA_FLAG_GIF | DMA_FLAG_TCIF | DMA_FLAG_HTIF | DMA_FLAG_TEIF);
+
+    if (result != RESULT_NOTHING && _cxt.channel[channel].callback)
+    {
+        _cxt.channel[channel].callback(_cxt.channel[channel].arg, result);
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file drv_dma.h
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief DMA1 driver implementation for stm32f103xx series
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef _DRV_DMA_
+#define _DRV_DMA_
+
+#include "types.h"
+#include "stm32f103xb.h"
+#include "macro.h"
+
+typedef enum
+{
+    DD_CHANNEL_1,
+    DD_CHANNEL_2,
+    DD_CHANNEL_3,
+    DD_CHANNEL_4,
+    DD_CHANNEL_5,
+    DD_CHANNEL_6,
+    DD_CHANNEL_7,
+
+    DD_CHANNEL_NUM
+} eDrvDmaChannel_t;
+
+typedef enum
+{
+    DD_DIR_PERIPH_TO_MEM,
+    DD_DIR_MEM_TO_PERIPH
+} eDrvDmaDirection_t;
+
+typedef enum
+{
+    DD_SIZE_8   = 0,
+    DD_SIZE_16  = 1,
+    DD_SIZE_32  = 2
+} eDrvDmaSize_t;
+
+typedef enum
+{
+    DD_PRIORITY_LOW,
+    DD_PRIORITY_MEDIUM,
+    DD_PRIORITY_HIGH,
+    DD_PRIORITY_VERY_HIGH
+} eDrvDmaPriority_t;
+
+/**
+ * @brief Transfer complete callback. Called from the DMA interrupt
+ * 
+ * @param arg The argument registered together with the callback
+ * @param result RESULT_OK if transfer completed, RESULT_FAIL on transfer error
+ */
+typedef void (*drv_dma_callback_t)(void * arg, result_t result);
+
+typedef struct
+{
+    eDrvDmaDirection_t  direction;
+    eDrvDmaSize_t       periph_size;
+    eDrvDmaSize_t       mem_size;
+    eDrvDmaPriority_t   priority;
+    volatile void *     periph_addr;
+    volatile void *     mem_addr;
+    uint16_t            count;
+    BOOL                mem_increment;
+    drv_dma_callback_t  callback;       //optional, enables transfer complete interrupt
+    void *              callback_arg;
+} xDrvDmaTransfer_t;
+
+/**
+ * @brief Configure the channel with transfer parameters and start it
+ * 
+ * @param channel The DMA1 channel
+ * @param transfer Transfer parameters
+ * @return result_t RESULT_OK if the channel was started
+ */
+result_t drv_dma_start(eDrvDmaChannel_t channel, xDrvDmaTransfer_t * transfer);
+
+/**
+ * @brief Disable the channel and clear its pending flags
+ * 
+ * @param channel The DMA1 channel
+ */
+void drv_dma_stop(eDrvDmaChannel_t channel);
+
+/**
+ * @brief Check whether the channel has finished its transfer
+ * 
+ * @param channel The DMA1 channel
+ * @return BOOL TRUE if transfer complete flag is set
+ */
+BOOL drv_dma_is_complete(eDrvDmaChannel_t channel);
+
+/**
+ * @brief Get the amount of data items the channel still has to transfer
+ * 
+ * @param channel The DMA1 channel
+ * @return uint16_t Remaining items
+ */
+uint16_t drv_dma_get_remaining(eDrvDmaChannel_t channel);
+
+/**
+ * @brief Common interrupt handler for DMA1 channels
+ * 
+ * @param channel The channel that raised the interrupt
+ */
+void drv_dma_irq_handler(eDrvDmaChannel_t channel);
+
+#endif  //_DRV_DMA_
@@ -0,0 +1,87 @@
+/**
+ * @file drv_dwt.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief DWT cycle counter driver for stm32f103xx series. Used to measure
+ *      execution time of the code in core clock cycles
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "drv_dwt.h"
+#include "drv_clocks.h"
+
+/**
+ * @brief Enable trace and start the cycle counter
+ * 
+ */
+void drv_dwt_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief Get the current value of the cycle counter. It wraps around every
+ *      2^32 cycles, so the difference of two values is valid for up to a
+ *      minute at 72 MHz
+ * 
+ * @return uint32_t Core clock cycles
+ */
+uint32_t drv_dwt_get_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Get the deadline the time from now. The counter is started if needed
+ * 
+ * @param us The time from now, us. Up to 29 s at 72 MHz
+ * @return uint32_t The deadline to check with drv_dwt_is_expired()
+ */
+uint32_t drv_dwt_get_deadline(uint32_t us)
+{
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        drv_dwt_init();
+    }
+
+    return DWT->CYCCNT + us * (drv_clocks_get_hclk() / 1000000);
+}
+
+/**
+ * @brief Check whether the deadline has passed
+ * 
+ * @param deadline The deadline from drv_dwt_get_deadline()
+ * @return BOOL TRUE if the deadline has passed
+ */
+BOOL drv_dwt_is_expired(uint32_t deadline)
+{
+    return (int32_t)(DWT->CYCCNT - deadline) >= 0;
+}
+
+/**
+ * @brief Convert cycle counter difference to microseconds
+ * 
+ * @param cycles The amount of cycles
+ * @return uint32_t Microseconds
+ */
+uint32_t drv_dwt_cycles_to_us(uint32_t cycles)
+{
+    return cycles / (drv_clocks_get_hclk() / 1000000);
+}
+
+/**
+ * @brief Busy wait using the cycle counter. Used where the scheduler can not
+ *      be used to wait
+ * 
+ * @param us The time to wait, us
+ */
+void drv_dwt_delay_us(uint32_t us)
+{
+    uint32_t deadline = drv_dwt_get_deadline(us);
+
+    while (!drv_dwt_is_expired(deadline));
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+/**
+ * @file drv_dwt.h
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief DWT cycle counter driver for stm32f103xx series. Used to measure
+ *      execution time of the code in core clock cycles
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef _DRV_DWT_
+#define _DRV_DWT_
+
+#include "types.h"
+#include "stm32f103xb.h"
+#include "macro.h"
+
+/**
+ * @brief Enable trace and start the cycle counter
+ * 
+ */
+void drv_dwt_init(void);
+
+/**
+ * @brief Get the current value of the cycle counter. It wraps around every
+ *      2^32 cycles, so the difference of two values is valid for up to a
+ *      minute at 72 MHz
+ * 
+ * @return uint32_t Core clock cycles
+ */
+uint32_t drv_dwt_get_cycles(void);
+
+/**
+ * @brief Get the deadline the time from now. The counter is started if needed
+ * 
+ * @param us The time from now, us. Up to 29 s at 72 MHz
+ * @return uint32_t The deadline to check with drv_dwt_is_expired()
+ */
+uint32_t drv_dwt_get_deadline(uint32_t us);
+
+/**
+ * @brief Check whether the deadline has passed
+ * 
+ * @param deadline The deadline from drv_dwt_get_deadline()
+ * @return BOOL TRUE if the deadline has passed
+ */
+BOOL drv_dwt_is_expired(uint32_t deadline);
+
+/**
+ * @brief Convert cycle counter difference to microseconds
+ * 
+ * @param cycles The amount of cycles
+ * @return uint32_t Microseconds
+ */
+uint32_t drv_dwt_cycles_to_us(uint32_t cycles);
+
+/**
+ * @brief Busy wait using the cycle counter. Used where the scheduler can not
+ *      be used to wait
+ * 
+ * @param us The time to wait, us
+ */
+void drv_dwt_delay_us(uint32_t us);
+
+#endif  //_DRV_DWT_
\ No newline at end of file
@@ -0,0 +1,123 @@
+/**
+ * @file drv_flash.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Flash memory programming driver for stm32f103xx series. Used to
+ *      keep small amounts of data in the pages excluded from the program
+ *      area by the linker script
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "drv_flash.h"
+#include "drv_dwt.h"
+
+#define DRV_FLASH_ERASE_TIMEOUT_US      50000   //Page erase takes up to 40 ms
+#define DRV_FLASH_PROGRAM_TIMEOUT_US    100     //Half-word programming takes up to 70 us
+
+/**
+ * @brief Unlock the flash program and erase controller
+ * 
+ */
+static void _unlock(void)
+{
+    if (FLASH->CR & FLASH_CR_LOCK)
+    {
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+}
+
+/**
+ * @brief Wait for the end of the operation and check its errors
+ * 
+ * @param timeout_us The maximum time of the operation, us
+ * @return result_t RESULT_OK if the operation succeeded
+ */
+static result_t _wait_ready(uint32_t timeout_us)
+{
+    uint32_t deadline = drv_dwt_get_deadline(timeout_us);
+
+    while (FLASH->SR & FLASH_SR_BSY)
+    {
+        if (drv_dwt_is_expired(deadline))
+        {
+            return RESULT_TIMEOUT;
+        }
+    }
+
+    if (FLASH->SR & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR))
+    {
+        FLASH->SR = FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+        return RESULT_FAIL;
+    }
+
+    FLASH->SR = FLASH_SR_EOP;
+    return RESULT_OK;
+}
+
+/**
+ * @brief Erase the page. The core stalls on the code fetch until the erase
+ *      ends, up to 40 ms
+ * 
+ * @param address The page start address
+ * @return result_t RESULT_OK if the page is erased
+ */
+result_t drv_flash_erase_page(uint32_t address)
+{
+    _unlock();
+
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR = address;
+    FLASH->CR |= FLASH_CR_STRT;
+
+    result_t result = _wait_ready(DRV_FLASH_ERASE_TIMEOUT_US);
+
+    FLASH->CR &= ~FLASH_CR_PER;
+    FLASH->CR |= FLASH_CR_LOCK;
+
+    return result;
+}
+
+/**
+ * @brief Program the erased flash by half-words
+ * 
+ * @param address The destination address, half-word aligned
+ * @param data The data to write
+ * @param size The size of the data, bytes. Rounded up to half-words
+ * @return result_t RESULT_OK if the data is written and reads back
+ */
+result_t drv_flash_write(uint32_t address, void const * data, uint32_t size)
+{
+    uint8_t const * src = (uint8_t const *)data;
+    volatile uint16_t * dst = (volatile uint16_t *)address;
+    result_t result = RESULT_OK;
+
+    _unlock();
+    FLASH->CR |= FLASH_CR_PG;
+
+    for (uint32_t i = 0; i < size && result == RESULT_OK; i += sizeof(uint16_t))
+    {
+        uint16_t half_word = src[i];
+
+        if (i + 1 < size)
+        {
+            half_word |= src[i + 1] << 8;
+        }
+
+        *dst = half_word;
+        result = _wait_ready(DRV_FLASH_PROGRAM_TIMEOUT_US);
+
+        if (result == RESULT_OK && *dst != half_word)
+        {
+            result = RESULT_FAIL;
+        }
+        dst++;
+    }
+
+    FLASH->CR &= ~FLASH_CR_PG;
+    FLASH->CR |= FLASH_CR_LOCK;
+
+    return result;
+}
\ No newline at end of file
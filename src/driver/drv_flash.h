@@ -0,0 +1,41 @@
+/**
+ * @file drv_flash.h
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Flash memory programming driver for stm32f103xx series. Used to
+ *      keep small amounts of data in the pages excluded from the program
+ *      area by the linker script
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef _DRV_FLASH_
+#define _DRV_FLASH_
+
+#include "types.h"
+#include "stm32f103xb.h"
+#include "macro.h"
+
+#define DRV_FLASH_PAGE_SIZE         KB(1)
+
+/**
+ * @brief Erase the page. The core stalls on the code fetch until the erase
+ *      ends, up to 40 ms
+ * 
+ * @param address The page start address
+ * @return result_t RESULT_OK if the page is erased
+ */
+result_t drv_flash_erase_page(uint32_t address);
+
+/**
+ * @brief Program the erased flash by half-words
+ * 
+ * @param address The destination address, half-word aligned
+ * @param data The data to write
+ * @param size The size of the data, bytes. Rounded up to half-words
+ * @return result_t RESULT_OK if the data is written and reads back
+ */
+result_t drv_flash_write(uint32_t address, void const * data, uint32_t size);
+
+#endif  //_DRV_FLASH_
\ No newline at end of file
@@ -10,6 +10,9 @@
  */
 #include "drv_interrupts.h"
 #include "port.h"
+#include "drv_dma.h"
+#include "drv_usart.h"
+#include "drv_one_wire_tim.h"
 
 void NMI_Handler(void)
 {
@@ -37,4 +40,54 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
     xPortSysTickHandler();
+}
+
+void DMA1_Channel3_IRQHandler(void)
+{
+    drv_dma_irq_handler(DD_CHANNEL_3);
+}
+
+void DMA1_Channel4_IRQHandler(void)
+{
+    drv_dma_irq_handler(DD_CHANNEL_4);
+}
+
+void DMA1_Channel5_IRQHandler(void)
+{
+    drv_dma_irq_handler(DD_CHANNEL_5);
+}
+
+void DMA1_Channel6_IRQHandler(void)
+{
+    drv_dma_irq_handler(DD_CHANNEL_6);
+}
+
+void USART1_IRQHandler(void)
+{
+    drv_usart_irq_handler(DU_USART1);
+}
+
+void USART2_IRQHandler(void)
+{
+    drv_usart_irq_handler(DU_USART2);
+}
+
+void USART3_IRQHandler(void)
+{
+    drv_usart_irq_handler(DU_USART3);
+}
+
+void TIM2_IRQHandler(void)
+{
+    drv_one_wire_tim_irq_handler(2);
+}
+
+void TIM3_IRQHandler(void)
+{
+    drv_one_wire_tim_irq_handler(3);
+}
+
+void TIM4_IRQHandler(void)
+{
+    drv_one_wire_tim_irq_handler(4);
 }
\ No newline at end of file
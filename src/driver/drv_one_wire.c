@@ -9,156 +9,793 @@
  * 
  */
 #include "drv_one_wire.h"
-#include "stm32f103xb.h"
-#include "drv_usart.h"
+#include "drv_dwt.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+#define ONE_WIRE_BITS_PER_BYTE      8
 
 /**
- * @brief Sends a bit to 1-Wire line
+ * @brief Update the error counters of the bus with the result of a primitive
  * 
- * @param bit The bit to send
+ * @param bus The bus
+ * @param result The result of the primitive
+ * @param start The cycle counter at the start of the primitive
+ * @return result_t The result, passed through
  */
-void drv_one_wire_write_bit(uint8_t bit) 
+static result_t _account(xDrvOneWireBus_t * bus, result_t result, uint32_t start)
 {
-    volatile uint8_t data;
-    
-    switch (bit) 
+    uint32_t time_us = drv_dwt_cycles_to_us(drv_dwt_get_cycles() - start);
+
+    switch (result)
     {
-      case 0: 
-        data = 0x00;
-        break;
-      case 1: 
-        data = 0xFF;
-        break;
+        case RESULT_NO_DEVICE:  bus->stats.presence_failures++;    break;
+        case RESULT_TIMEOUT:    bus->stats.slot_timeouts++;        break;
+        case RESULT_BUS_ERROR:  bus->stats.framing_errors++;       break;
+        default:                                                   break;
     }
-    
-    drv_usart_putc(DU_USART2, data);
-    while(drv_usart_getc(DU_USART2, (uint8_t *)&data) != RESULT_OK && !(data == 0x00 || data == 0xFF));
+
+    bus->stats.worst_transaction_us = MAX(bus->stats.worst_transaction_us, time_us);
+
+    return result;
+}
+
+/**
+ * @brief Send a slot and sample the line
+ * 
+ * @param bus The bus to use
+ * @param bit The bit to send, 1 to read
+ * @param sampled[out] The line state, 1 if the slot failed
+ * @return result_t RESULT_OK if the slot was sent
+ */
+static result_t _touch_bit(xDrvOneWireBus_t * bus, uint8_t bit, uint8_t * sampled)
+{
+    uint32_t start = drv_dwt_get_cycles();
+
+    *sampled = 1;
+
+    return _account(bus, bus->ops->touch_bit(bus->hw, bit, sampled), start);
+}
+
+/**
+ * @brief Sends a bit to 1-Wire line
+ * 
+ * @param bus The bus to use
+ * @param bit The bit to send
+ * @return result_t RESULT_OK if the slot was sent
+ */
+result_t drv_one_wire_write_bit(xDrvOneWireBus_t * bus, uint8_t bit)
+{
+    uint8_t sampled;
+
+    return _touch_bit(bus, bit, &sampled);
 }
 
 /**
  * @brief Sends a byte to 1-Wire line
  * 
+ * @param bus The bus to use
  * @param byte The byte to send
+ * @return result_t RESULT_OK if the byte was sent
  */
-void drv_one_wire_write_byte(uint8_t byte)
+result_t drv_one_wire_write_byte(xDrvOneWireBus_t * bus, uint8_t byte)
 {
-    for (uint8_t i = 0; i < 8; i++)
-    {
-        drv_one_wire_write_bit((byte >> i) & 0x01);
-    }
+    return drv_one_wire_write_data(bus, &byte, 1);
 }
 
 /**
  * @brief Sends data to 1-Wire line
  * 
+ * @param bus The bus to use
  * @param data Pointer to the data to send
  * @param length The amount of data
+ * @return result_t RESULT_OK if the data was sent
+ */
+result_t drv_one_wire_write_data(xDrvOneWireBus_t * bus, uint8_t * data, uint8_t length)
+{
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = FALSE,
+        .rom_command = ONE_WIRE_NO_COMMAND,
+        .command = ONE_WIRE_NO_COMMAND,
+        .tx = data,
+        .tx_length = length
+    };
+
+    return drv_one_wire_transaction(bus, &transaction);
+}
+
+/**
+ * @brief Read bit from 1-Wire line. A failed slot reads as 1 and is counted
+ *      in the bus statistics
+ * 
+ * @param bus The bus to use
+ * @return uint8_t Read bit
+ */
+uint8_t drv_one_wire_read_bit(xDrvOneWireBus_t * bus)
+{
+    uint8_t sampled;
+
+    _touch_bit(bus, 1, &sampled);
+
+    return sampled;
+}
+
+/**
+ * @brief Read byte from 1-Wire line
+ * 
+ * @param bus The bus to use
+ * @return uint8_t Read byte
+ */
+uint8_t drv_one_wire_read_byte(xDrvOneWireBus_t * bus)
+{
+    uint8_t byte = 0;
+
+    drv_one_wire_read_data(bus, &byte, 1);
+
+    return byte;
+}
+
+/**
+ * @brief Read the data from 1-Wire line
+ * 
+ * @param bus The bus to use
+ * @param data Pointer to the place where to store read data
+ * @param length The amount of bytes to read
+ * @return result_t RESULT_OK if the data was read
+ */
+result_t drv_one_wire_read_data(xDrvOneWireBus_t * bus, uint8_t * data, uint8_t length)
+{
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = FALSE,
+        .rom_command = ONE_WIRE_NO_COMMAND,
+        .command = ONE_WIRE_NO_COMMAND,
+        .rx = data,
+        .rx_length = length
+    };
+
+    return drv_one_wire_transaction(bus, &transaction);
+}
+
+/**
+ * @brief Performs PRESENSE pulse on 1-Wire line (reset pulse)
+ * 
+ * @param bus The bus to use
+ * @return result_t RESULT_OK if presence was detected, RESULT_NO_DEVICE if
+ *      not, RESULT_TIMEOUT or RESULT_BUS_ERROR if the bus failed
+ */
+result_t drv_one_wire_reset(xDrvOneWireBus_t * bus)
+{
+    uint32_t start = drv_dwt_get_cycles();
+
+    return _account(bus, bus->ops->reset(bus->hw), start);
+}
+
+/**
+ * @brief Execute 1-Wire transaction: reset, ROM command with ROM, function
+ *      command, write and read data, and the transactions chained after it
+ *      back to back. Depending on the backend the calling task may sleep
+ *      until the last slot completes
+ * 
+ * @param bus The bus to use
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed,
+ *      RESULT_NO_DEVICE if there was no presence pulse, RESULT_TIMEOUT if the
+ *      hardware did not finish in time, RESULT_BUS_ERROR if the line is held low
+ */
+result_t drv_one_wire_transaction(xDrvOneWireBus_t * bus, xDrvOneWireTransaction_t * transaction)
+{
+    uint32_t start = drv_dwt_get_cycles();
+
+    return _account(bus, bus->ops->transaction(bus->hw, transaction), start);
+}
+
+/**
+ * @brief Get the time the backend waits for the transaction with the
+ *      transactions chained after it, ONE_WIRE_TRANSACTION_TIMEOUT_MS each
+ * 
+ * @param transaction The first transaction
+ * @return uint32_t The timeout, ms
  */
-void drv_one_wire_write_data(uint8_t * data, uint8_t length)
+uint32_t drv_one_wire_get_timeout_ms(xDrvOneWireTransaction_t const * transaction)
 {
-    for (uint8_t i = 0; i < length; i++)
+    uint32_t timeout_ms = 0;
+
+    for (; transaction; transaction = transaction->next)
     {
-        drv_one_wire_write_byte(*(data + i));
+        timeout_ms += ONE_WIRE_TRANSACTION_TIMEOUT_MS;
     }
+
+    return timeout_ms;
 }
 
 /**
- * @brief Read bit from 1-Wire line
+ * @brief Build the header bytes of the transaction: ROM command, ROM and
+ *      function command, for the scripts that write the header themselves
  * 
- * @return uint8_t Read bit
+ * @param transaction[in] The transaction
+ * @param header[out] The header, up to ONE_WIRE_HEADER_MAX bytes
+ * @return uint8_t The amount of header bytes
  */
-uint8_t drv_one_wire_read_bit(void) 
+uint8_t drv_one_wire_build_header(xDrvOneWireTransaction_t const * transaction, uint8_t * header)
 {
-    uint8_t bit;    
-    volatile uint16_t counter = 0xFFFF;
-    uint8_t read_usart_byte;
+    uint8_t length = 0;
 
-    drv_one_wire_write_bit(1);
-    volatile result_t res = RESULT_NOTHING;
-    while (counter-- > 0 && res == RESULT_NOTHING)
+    if (transaction->rom_command != ONE_WIRE_NO_COMMAND)
     {
-        res = drv_usart_getc(DU_USART2, &read_usart_byte);
+        header[length++] = transaction->rom_command;
+
+        if (transaction->rom)
+        {
+            memcpy(&header[length], transaction->rom, ONE_WIRE_ROM_SIZE);
+            length += ONE_WIRE_ROM_SIZE;
+        }
     }
-        
-    if (res != RESULT_OK)
+
+    if (transaction->command != ONE_WIRE_NO_COMMAND)
     {
-        DEBUG_PRINT("1-Wire: failed to read bit\r\n");
+        header[length++] = transaction->command;
     }
 
-    if (read_usart_byte < 0xFF)  
+    return length;
+}
+
+/**
+ * @brief Get the error counters of the bus
+ * 
+ * @param bus The bus
+ * @return xDrvOneWireStats_t const* The counters
+ */
+xDrvOneWireStats_t const * drv_one_wire_get_stats(xDrvOneWireBus_t * bus)
+{
+    return &bus->stats;
+}
+
+/**
+ * @brief Configure the strong pull-up pin of the bus. The pin is push-pull
+ *      output driving P-channel MOSFET gate, low level enables the pull-up
+ * 
+ * @param bus The bus to use
+ * @param port The port of the pin
+ * @param pin The pin number
+ */
+void drv_one_wire_strong_pullup_init(xDrvOneWireBus_t * bus, GPIO_TypeDef * port, uint8_t pin)
+{
+    volatile uint32_t * cr = (pin < 8) ? &port->CRL : &port->CRH;
+    uint32_t shift = (pin % 8) * 4;
+
+    if (port == GPIOA)
     {
-        bit = 0;
+        RCC->APB2ENR |= RCC_APB2ENR_IOPAEN;
     }
-    else if (read_usart_byte == 0xFF)  
+    else if (port == GPIOB)
     {
-        bit = 1;
+        RCC->APB2ENR |= RCC_APB2ENR_IOPBEN;
     }
-    
-    return bit;
+    else if (port == GPIOC)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_IOPCEN;
+    }
+
+    port->BSRR = 1 << pin;
+
+    //Output 10MHz, general purpose push-pull
+    *cr = (*cr & ~(0xFUL << shift)) | (GPIO_CRL_MODE0_0 << shift);
+
+    bus->pullup.port = port;
+    bus->pullup.pin = pin;
 }
 
 /**
- * @brief Read byte from 1-Wire line
+ * @brief Drive the strong pull-up pin. Safe in interrupt context
  * 
- * @return uint8_t Read byte
+ * @param pullup The pull-up pin
+ * @param is_enabled TRUE to enable
  */
-uint8_t drv_one_wire_read_byte(void) 
+static void _pullup_set(xDrvOneWirePullup_t const * pullup, BOOL is_enabled)
 {
-    uint8_t byte = 0;
-    
-    for (uint8_t i = 0; i < 8; i++)
+    pullup->port->BSRR = is_enabled ? (1UL << (pullup->pin + 16)) : (1UL << pullup->pin);
+}
+
+/**
+ * @brief Enable or disable the strong pull-up of the bus. Must be enabled
+ *      within 10 us of the last slot of the command that needs power, which
+ *      a task can't guarantee, so DOW_STEP_PULLUP has the backend enable it.
+ *      Disable it before the next slot
+ * 
+ * @param bus The bus to use
+ * @param is_enabled TRUE to enable
+ * @return result_t RESULT_OK if the bus has the strong pull-up
+ */
+result_t drv_one_wire_strong_pullup(xDrvOneWireBus_t * bus, BOOL is_enabled)
+{
+    if (!bus->pullup.port)
     {
-        byte |= drv_one_wire_read_bit() << i;
+        return RESULT_FAIL;
     }
-    
-    return byte;
+
+    _pullup_set(&bus->pullup, is_enabled);
+
+    return RESULT_OK;
 }
 
 /**
- * @brief Read the data from 1-Wire line
+ * @brief Set the speed of the following slots and reset pulses. Devices
+ *      must be switched to overdrive before with drv_one_wire_overdrive_skip_rom()
+ *      or drv_one_wire_overdrive_match_rom()
  * 
- * @param data Pointer to the place where to store read data
- * @param length The amount of bytes to read
+ * @param bus The bus to use
+ * @param speed The speed
+ * @return result_t RESULT_OK if the backend supports the speed
  */
-void drv_one_wire_read_data(uint8_t * data, uint8_t length) 
+result_t drv_one_wire_set_speed(xDrvOneWireBus_t * bus, eDrvOneWireSpeed_t speed)
 {
-    for (uint8_t i = 0; i < length; i++)
+    if (!bus->ops->set_speed)
     {
-         *(data + i) = drv_one_wire_read_byte();
+        return (speed == DOW_SPEED_STANDARD) ? RESULT_OK : RESULT_FAIL;
     }
+
+    return bus->ops->set_speed(bus->hw, speed);
 }
 
 /**
- * @brief Performs PRESENSE pulse on 1-Wire line (reset pulse)
+ * @brief Send the overdrive ROM command at standard speed and check the
+ *      presence at overdrive. Standard reset returns all devices to standard
+ *      speed if nobody answers
  * 
- * @return result_t RESULT_OK if operation succeed
+ * @param bus The bus to use
+ * @param rom_command Overdrive Skip ROM or Overdrive Match ROM
+ * @param rom The ROM for Overdrive Match ROM, sent at overdrive
+ * @return eDrvOneWireSpeed_t The speed the bus was left at
  */
-result_t drv_one_wire_reset(void) 
+static eDrvOneWireSpeed_t _overdrive_enter(xDrvOneWireBus_t * bus, uint8_t rom_command, uint8_t const * rom)
 {
-    result_t res = RESULT_FAIL;
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = rom_command,
+        .command = ONE_WIRE_NO_COMMAND
+    };
+
+    drv_one_wire_set_speed(bus, DOW_SPEED_STANDARD);
 
-    xDrvUsartPortParams_t usart_params = {DU_USART2, DU_DATA_BITS_8, DU_STOP_BITS_1, DU_NO_PARITY, 9600};
-    if (drv_usart_init_port(&usart_params) == RESULT_OK)
+    if (drv_one_wire_transaction(bus, &transaction) != RESULT_OK ||
+        drv_one_wire_set_speed(bus, DOW_SPEED_OVERDRIVE) != RESULT_OK)
     {
-        //USART2->DR;
-        drv_usart_putc(DU_USART2, 0xF0);
-        uint8_t read_usart_byte = 0;
+        drv_one_wire_set_speed(bus, DOW_SPEED_STANDARD);
+        drv_one_wire_reset(bus);
+        return DOW_SPEED_STANDARD;
+    }
 
-        volatile result_t res_read = RESULT_NOTHING;
-        while (res_read != RESULT_OK)
+    if (rom)
+    {
+        xDrvOneWireTransaction_t rom_transaction = {
+            .is_reset = FALSE,
+            .rom_command = ONE_WIRE_NO_COMMAND,
+            .command = ONE_WIRE_NO_COMMAND,
+            .tx = rom,
+            .tx_length = ONE_WIRE_ROM_SIZE
+        };
+
+        drv_one_wire_transaction(bus, &rom_transaction);
+    }
+
+    if (drv_one_wire_reset(bus) != RESULT_OK)
+    {
+        DEBUG_PRINT("1-Wire: no answer at overdrive, back to standard speed");
+        drv_one_wire_set_speed(bus, DOW_SPEED_STANDARD);
+        drv_one_wire_reset(bus);
+        return DOW_SPEED_STANDARD;
+    }
+
+    return DOW_SPEED_OVERDRIVE;
+}
+
+/**
+ * @brief Switch all overdrive capable devices to overdrive with Overdrive Skip
+ *      ROM and leave the bus at overdrive if any of them answers the overdrive
+ *      reset. Otherwise the bus and the devices are returned to standard speed
+ * 
+ * @param bus The bus to use
+ * @return eDrvOneWireSpeed_t The speed the bus was left at
+ */
+eDrvOneWireSpeed_t drv_one_wire_overdrive_skip_rom(xDrvOneWireBus_t * bus)
+{
+    return _overdrive_enter(bus, ONE_WIRE_CMD_OVERDRIVE_SKIP_ROM, 0);
+}
+
+/**
+ * @brief Switch the device to overdrive with Overdrive Match ROM and leave the
+ *      bus at overdrive if the device answers the overdrive reset. The reset
+ *      deselects the device, so address it again with Match ROM at overdrive.
+ *      Devices that don't answer are returned to standard speed
+ * 
+ * @param bus The bus to use
+ * @param rom The ROM of the device
+ * @return eDrvOneWireSpeed_t The speed the bus was left at
+ */
+eDrvOneWireSpeed_t drv_one_wire_overdrive_match_rom(xDrvOneWireBus_t * bus, uint8_t const * rom)
+{
+    return _overdrive_enter(bus, ONE_WIRE_CMD_OVERDRIVE_MATCH_ROM, rom);
+}
+
+/**
+ * @brief Keep the bus idle at least for the time. The task sleeps if the
+ *      scheduler runs, the time is rounded up to whole ticks plus one as
+ *      vTaskDelay() may return up to one tick early
+ * 
+ * @param time_ms The time, ms
+ */
+static void _delay_ms(uint16_t time_ms)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+    {
+        vTaskDelay((time_ms * configTICK_RATE_HZ + 999UL) / 1000 + 1);
+    }
+    else
+    {
+        drv_dwt_delay_us(time_ms * 1000UL);
+    }
+}
+
+/**
+ * @brief Execute the list of steps back to back. Reset, write and read steps
+ *      are merged into transactions chained together, the whole chain is one
+ *      backend submission, up to ONE_WIRE_SCRIPT_MAX_CHAIN transactions.
+ *      Pull-up and delay steps are executed between the chains, the strong
+ *      pull-up is enabled by the backend right after the chain before it
+ * 
+ * @param bus The bus to use
+ * @param steps[in/out] The steps to execute, read steps get the data
+ * @param count The amount of steps
+ * @return result_t RESULT_OK if all steps completed, otherwise the result
+ *      of the failed step, the rest of the script is skipped
+ */
+result_t drv_one_wire_script(xDrvOneWireBus_t * bus, xDrvOneWireStep_t const * steps, uint16_t count)
+{
+    xDrvOneWireTransaction_t * chain = bus->chain;
+    xDrvOneWireTransaction_t * transaction = 0;
+    uint8_t length = 0;
+    result_t result = RESULT_OK;
+
+    for (uint16_t i = 0; i <= count && result == RESULT_OK; i++)
+    {
+        xDrvOneWireStep_t const * step = (i < count) ? &steps[i] : 0;
+        BOOL is_slots = step && (step->type == DOW_STEP_RESET || step->type == DOW_STEP_WRITE || step->type == DOW_STEP_READ);
+
+        // A transaction is reset, then write, then read. Anything out of
+        // this order starts the next transaction of the chain
+        BOOL is_fit = is_slots && transaction && (
+            (step->type == DOW_STEP_WRITE && !transaction->tx_length && !transaction->rx_length) ||
+            (step->type == DOW_STEP_READ && !transaction->rx_length));
+
+        // Pull-up and delay steps, the end of the script and the full chain
+        // send the collected transactions
+        if (length && (!is_slots || (!is_fit && length == ONE_WIRE_SCRIPT_MAX_CHAIN)))
+        {
+            if (step && step->type == DOW_STEP_PULLUP && bus->pullup.port)
+            {
+                chain[length - 1].pullup = &bus->pullup;
+            }
+
+            result = drv_one_wire_transaction(bus, chain);
+            transaction = 0;
+            length = 0;
+        }
+
+        if (!step || result != RESULT_OK)
+        {
+            continue;
+        }
+
+        if (is_slots && !is_fit)
         {
-            res_read = drv_usart_getc(DU_USART2, &read_usart_byte);
+            transaction = &chain[length];
+            memset(transaction, 0, sizeof(*transaction));
+            if (length)
+            {
+                chain[length - 1].next = transaction;
+            }
+            length++;
         }
 
-        if (read_usart_byte < 0xF0)
+        switch (step->type)
         {
-            //usart_params.baudrate = 115200;
-            usart_params.baudrate = 120000;
-            drv_usart_init_port(&usart_params);
-            
-            res = RESULT_OK;
+            case DOW_STEP_RESET:
+                transaction->is_reset = TRUE;
+                break;
+            case DOW_STEP_WRITE:
+                transaction->tx = step->tx;
+                transaction->tx_length = step->length;
+                break;
+            case DOW_STEP_READ:
+                transaction->rx = step->rx;
+                transaction->rx_length = step->length;
+                break;
+            case DOW_STEP_PULLUP:
+                // The backend has enabled it after the last slot of the chain,
+                // this one covers a pull-up step with nothing sent before it.
+                // Without strong pull-up the line is powered through the pull-up resistor only
+                drv_one_wire_strong_pullup(bus, TRUE);
+                _delay_ms(step->time_ms);
+                drv_one_wire_strong_pullup(bus, FALSE);
+                break;
+            case DOW_STEP_DELAY:
+                _delay_ms(step->time_ms);
+                break;
         }
     }
 
-    return res;
+    return result;
+}
+
+/**
+ * @brief Execute the transaction slot by slot with reset and touch_bit
+ *      operations of the backend. Used by backends before the scheduler starts
+ * 
+ * @param ops The backend operations
+ * @param hw The backend instance
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed
+ */
+result_t drv_one_wire_polled_transaction(xDrvOneWireOps_t const * ops, void * hw, xDrvOneWireTransaction_t * transaction)
+{
+    xDrvOneWireCursor_t cursor;
+    result_t result = RESULT_OK;
+    eDrvOneWireSlot_t slot;
+
+    drv_one_wire_cursor_init(&cursor, transaction);
+
+    while ((slot = drv_one_wire_cursor_next_slot(&cursor)) != DOW_SLOT_NONE)
+    {
+        uint8_t sampled = 1;
+
+        if (slot == DOW_SLOT_RESET)
+        {
+            result = ops->reset(hw);
+            sampled = (result == RESULT_OK);
+            if (result != RESULT_OK && result != RESULT_NO_DEVICE)
+            {
+                return result;
+            }
+        }
+        else
+        {
+            result = ops->touch_bit(hw, slot == DOW_SLOT_1, &sampled);
+            if (result != RESULT_OK)
+            {
+                return result;
+            }
+        }
+
+        result = drv_one_wire_cursor_complete_slot(&cursor, sampled);
+        if (result == RESULT_NO_DEVICE)
+        {
+            return result;
+        }
+    }
+
+    return RESULT_OK;
+}
+
+/**
+ * @brief Get the amount of header bytes of the transaction: ROM command, ROM
+ *      and function command
+ * 
+ * @param transaction The transaction
+ * @return uint8_t The amount of bytes
+ */
+static uint8_t _header_length(xDrvOneWireTransaction_t const * transaction)
+{
+    uint8_t length = 0;
+
+    if (transaction->rom_command != ONE_WIRE_NO_COMMAND)
+    {
+        length += transaction->rom ? 1 + ONE_WIRE_ROM_SIZE : 1;
+    }
+
+    if (transaction->command != ONE_WIRE_NO_COMMAND)
+    {
+        length++;
+    }
+
+    return length;
+}
+
+/**
+ * @brief Build the header of the transaction the cursor sends
+ * 
+ * @param cursor The cursor
+ */
+static void _cursor_build_header(xDrvOneWireCursor_t * cursor)
+{
+    cursor->header_length = drv_one_wire_build_header(cursor->tx.transaction, cursor->header);
+}
+
+/**
+ * @brief Get the amount of bytes in the transaction phase
+ * 
+ * @param transaction The transaction
+ * @param phase The phase
+ * @return uint8_t The amount of bytes
+ */
+static uint8_t _cursor_phase_length(xDrvOneWireTransaction_t const * transaction, uint8_t phase)
+{
+    uint8_t length = 0;
+
+    switch (phase)
+    {
+        case DOW_PHASE_RESET:   length = transaction->is_reset ? 1 : 0;    break;
+        case DOW_PHASE_HEADER:  length = _header_length(transaction);       break;
+        case DOW_PHASE_WRITE:   length = transaction->tx_length;            break;
+        case DOW_PHASE_READ:    length = transaction->rx_length;            break;
+    }
+
+    return length;
+}
+
+/**
+ * @brief Skip finished and empty phases, at the end of the transaction go
+ *      on with the chained one
+ * 
+ * @param cursor The cursor
+ * @param position The position to normalize
+ */
+static void _cursor_normalize(xDrvOneWireCursor_t * cursor, xDrvOneWirePosition_t * position)
+{
+    while (position->phase < DOW_PHASE_DONE &&
+        position->index >= _cursor_phase_length(position->transaction, position->phase))
+    {
+        position->phase++;
+        position->index = 0;
+        position->bit = 0;
+
+        if (position->phase == DOW_PHASE_DONE && position->transaction->next)
+        {
+            position->transaction = position->transaction->next;
+            position->phase = DOW_PHASE_RESET;
+
+            if (position == &cursor->tx)
+            {
+                _cursor_build_header(cursor);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Move the position to the next slot. Reset takes one slot, bytes take 8
+ * 
+ * @param cursor The cursor
+ * @param position The position to move
+ */
+static void _cursor_step(xDrvOneWireCursor_t * cursor, xDrvOneWirePosition_t * position)
+{
+    if (position->phase == DOW_PHASE_RESET || ++position->bit == ONE_WIRE_BITS_PER_BYTE)
+    {
+        position->bit = 0;
+        position->index++;
+    }
+
+    _cursor_normalize(cursor, position);
+}
+
+/**
+ * @brief Prepare the cursor to walk the transaction
+ * 
+ * @param cursor[out] The cursor
+ * @param transaction[in] The transaction
+ */
+void drv_one_wire_cursor_init(xDrvOneWireCursor_t * cursor, xDrvOneWireTransaction_t * transaction)
+{
+    memset(&cursor->tx, 0, sizeof(cursor->tx));
+    memset(&cursor->rx, 0, sizeof(cursor->rx));
+    cursor->tx.transaction = transaction;
+    cursor->rx.transaction = transaction;
+
+    _cursor_build_header(cursor);
+    _cursor_normalize(cursor, &cursor->tx);
+    _cursor_normalize(cursor, &cursor->rx);
+}
+
+/**
+ * @brief Get the slot drv_one_wire_cursor_next_slot() returns next without
+ *      moving the cursor
+ * 
+ * @param cursor The cursor
+ * @return eDrvOneWireSlot_t The slot, DOW_SLOT_NONE if nothing left to send
+ */
+eDrvOneWireSlot_t drv_one_wire_cursor_peek_slot(xDrvOneWireCursor_t * cursor)
+{
+    xDrvOneWirePosition_t * tx = &cursor->tx;
+    uint8_t byte = 0xFF;
+
+    switch (tx->phase)
+    {
+        case DOW_PHASE_RESET:
+            return DOW_SLOT_RESET;
+        case DOW_PHASE_HEADER:
+            byte = cursor->header[tx->index];
+            break;
+        case DOW_PHASE_WRITE:
+            byte = tx->transaction->tx[tx->index];
+            break;
+        case DOW_PHASE_READ:
+            break;
+        default:
+            return DOW_SLOT_NONE;
+    }
+
+    return ((byte >> tx->bit) & 0x01) ? DOW_SLOT_1 : DOW_SLOT_0;
+}
+
+/**
+ * @brief Get the next slot to send
+ * 
+ * @param cursor The cursor
+ * @return eDrvOneWireSlot_t The slot, DOW_SLOT_NONE if nothing left to send
+ */
+eDrvOneWireSlot_t drv_one_wire_cursor_next_slot(xDrvOneWireCursor_t * cursor)
+{
+    eDrvOneWireSlot_t slot = drv_one_wire_cursor_peek_slot(cursor);
+
+    if (slot != DOW_SLOT_NONE)
+    {
+        _cursor_step(cursor, &cursor->tx);
+    }
+
+    return slot;
+}
+
+/**
+ * @brief Store the sampled line state of the oldest slot in flight. After
+ *      the last slot enables the strong pull-up of the last transaction
+ * 
+ * @param cursor The cursor
+ * @param sampled The line state, for reset slot TRUE if presence was detected
+ * @return result_t RESULT_NOTHING while more slots are expected, RESULT_OK
+ *      when the last slot completed, RESULT_NO_DEVICE if there was no presence
+ */
+result_t drv_one_wire_cursor_complete_slot(xDrvOneWireCursor_t * cursor, uint8_t sampled)
+{
+    xDrvOneWirePosition_t * rx = &cursor->rx;
+
+    switch (rx->phase)
+    {
+        case DOW_PHASE_RESET:
+            if (!sampled)
+            {
+                return RESULT_NO_DEVICE;
+            }
+            break;
+        case DOW_PHASE_READ:
+            if (rx->bit == 0)
+            {
+                rx->transaction->rx[rx->index] = 0;
+            }
+            if (sampled)
+            {
+                rx->transaction->rx[rx->index] |= 1 << rx->bit;
+            }
+            break;
+        case DOW_PHASE_DONE:
+            return RESULT_OK;
+    }
+
+    _cursor_step(cursor, rx);
+
+    if (rx->phase != DOW_PHASE_DONE)
+    {
+        return RESULT_NOTHING;
+    }
+
+    // Called by the backend as soon as the slot is sampled, usually from its
+    // interrupt, so parasite powered devices get the power in time
+    if (rx->transaction->pullup)
+    {
+        _pullup_set(rx->transaction->pullup, TRUE);
+    }
+
+    return RESULT_OK;
 }
\ No newline at end of file
@@ -12,16 +12,296 @@
 #define _DRV_ONE_WIRE_
 
 #include "types.h"
+#include "macro.h"
 #include "stm32f103xb.h"
 
-void drv_one_wire_write_bit(uint8_t bit);
-void drv_one_wire_write_byte(uint8_t byte);
-void drv_one_wire_write_data(uint8_t * data, uint8_t length);
-uint8_t drv_one_wire_read_bit(void);
-uint8_t drv_one_wire_read_byte(void);
-void drv_one_wire_read_data(uint8_t * data, uint8_t length);
-result_t drv_one_wire_reset(void);
+#define ONE_WIRE_NO_COMMAND         0x00    //Not a valid 1-Wire command, used to skip the step
+#define ONE_WIRE_ROM_SIZE           8
+#define ONE_WIRE_HEADER_MAX         (1 + ONE_WIRE_ROM_SIZE + 1)
+#define ONE_WIRE_SCRIPT_MAX_CHAIN   8       //Transactions of a script submitted to the backend at once
 
- 
+#define ONE_WIRE_CMD_OVERDRIVE_SKIP_ROM     0x3C    //Sent at standard speed, all capable devices go overdrive
+#define ONE_WIRE_CMD_OVERDRIVE_MATCH_ROM    0x69    //Sent at standard speed, ROM follows at overdrive
 
-#endif  //_DRV_ONE_WIRE_
\ No newline at end of file
+typedef enum
+{
+    DOW_SPEED_STANDARD,
+    DOW_SPEED_OVERDRIVE,
+
+    DOW_SPEED_NUM
+} eDrvOneWireSpeed_t;
+
+// Strong pull-up pin, push-pull output driving P-channel MOSFET gate
+typedef struct
+{
+    GPIO_TypeDef *  port;           //0 if not used
+    uint8_t         pin;
+} xDrvOneWirePullup_t;
+
+typedef struct xDrvOneWireTransaction_t
+{
+    BOOL            is_reset;       //Start with reset pulse and presence check
+    uint8_t         rom_command;    //ROM command (match, skip, ...) or ONE_WIRE_NO_COMMAND
+    uint8_t const * rom;            //ROM to send after ROM command, 0 if not needed
+    uint8_t         command;        //Function command or ONE_WIRE_NO_COMMAND
+    uint8_t const * tx;             //Data to write after the command
+    uint8_t         tx_length;
+    uint8_t *       rx;             //Place to store data read after write phase
+    uint8_t         rx_length;
+    xDrvOneWirePullup_t const * pullup;         //Strong pull-up to enable right after the last slot, 0 if not needed
+    struct xDrvOneWireTransaction_t * next;     //Executed right after this one, 0 if the last
+} xDrvOneWireTransaction_t;
+
+typedef enum
+{
+    DOW_STEP_RESET,                 //Reset pulse, the script fails without presence
+    DOW_STEP_WRITE,                 //Write block of length bytes
+    DOW_STEP_READ,                  //Read block of length bytes
+    DOW_STEP_PULLUP,                //Keep the line powered after the previous write for time_ms, the backend enables it right after the last slot
+    DOW_STEP_DELAY                  //Keep the bus idle for time_ms
+} eDrvOneWireStepType_t;
+
+// One step of a scripted transaction
+typedef struct
+{
+    eDrvOneWireStepType_t type;
+    union
+    {
+        uint8_t const * tx;         //DOW_STEP_WRITE data
+        uint8_t *       rx;         //DOW_STEP_READ data
+    };
+    uint8_t         length;
+    uint16_t        time_ms;
+} xDrvOneWireStep_t;
+
+typedef enum
+{
+    DOW_SLOT_NONE,
+    DOW_SLOT_RESET,
+    DOW_SLOT_0,
+    DOW_SLOT_1
+} eDrvOneWireSlot_t;
+
+typedef enum
+{
+    DOW_PHASE_RESET,
+    DOW_PHASE_HEADER,
+    DOW_PHASE_WRITE,
+    DOW_PHASE_READ,
+    DOW_PHASE_DONE
+} eDrvOneWirePhase_t;
+
+typedef struct
+{
+    xDrvOneWireTransaction_t * transaction;
+    uint8_t phase;
+    uint8_t index;
+    uint8_t bit;
+} xDrvOneWirePosition_t;
+
+// Walks the transaction and the ones chained after it slot by slot. Sending
+// and receiving positions are separate so backends may have several slots
+// in flight
+typedef struct
+{
+    uint8_t header[ONE_WIRE_HEADER_MAX];    //Header of the transaction being sent
+    uint8_t header_length;
+    xDrvOneWirePosition_t tx;
+    xDrvOneWirePosition_t rx;
+} xDrvOneWireCursor_t;
+
+// Bus backend operations
+typedef struct
+{
+    result_t (*reset)(void * hw);                                               //Reset pulse, RESULT_OK on presence
+    result_t (*touch_bit)(void * hw, uint8_t bit, uint8_t * sampled);           //Send slot, store sampled line
+    result_t (*transaction)(void * hw, xDrvOneWireTransaction_t * transaction); //Whole transaction
+    result_t (*set_speed)(void * hw, eDrvOneWireSpeed_t speed);                 //Optional, 0 if only standard speed
+} xDrvOneWireOps_t;
+
+// Bus error counters, updated by every primitive called through the bus
+typedef struct
+{
+    uint32_t presence_failures;                                                 //RESULT_NO_DEVICE
+    uint32_t slot_timeouts;                                                     //RESULT_TIMEOUT
+    uint32_t framing_errors;                                                    //RESULT_BUS_ERROR
+    uint32_t worst_transaction_us;                                              //Longest primitive, us
+} xDrvOneWireStats_t;
+
+typedef struct
+{
+    xDrvOneWireOps_t const * ops;
+    void * hw;                                                                  //Backend instance
+    xDrvOneWirePullup_t pullup;                                                 //Strong pull-up pin, port 0 if not used
+    xDrvOneWireStats_t stats;
+    xDrvOneWireTransaction_t chain[ONE_WIRE_SCRIPT_MAX_CHAIN];                  //Transactions of drv_one_wire_script(), kept off the task stack
+} xDrvOneWireBus_t;
+
+result_t drv_one_wire_write_bit(xDrvOneWireBus_t * bus, uint8_t bit);
+result_t drv_one_wire_write_byte(xDrvOneWireBus_t * bus, uint8_t byte);
+result_t drv_one_wire_write_data(xDrvOneWireBus_t * bus, uint8_t * data, uint8_t length);
+uint8_t drv_one_wire_read_bit(xDrvOneWireBus_t * bus);
+uint8_t drv_one_wire_read_byte(xDrvOneWireBus_t * bus);
+result_t drv_one_wire_read_data(xDrvOneWireBus_t * bus, uint8_t * data, uint8_t length);
+result_t drv_one_wire_reset(xDrvOneWireBus_t * bus);
+
+/**
+ * @brief Execute 1-Wire transaction: reset, ROM command with ROM, function
+ *      command, write and read data, and the transactions chained after it
+ *      back to back. Depending on the backend the calling task may sleep
+ *      until the last slot completes
+ * 
+ * @param bus The bus to use
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed,
+ *      RESULT_NO_DEVICE if there was no presence pulse, RESULT_TIMEOUT if the
+ *      hardware did not finish in time, RESULT_BUS_ERROR if the line is held low
+ */
+result_t drv_one_wire_transaction(xDrvOneWireBus_t * bus, xDrvOneWireTransaction_t * transaction);
+
+/**
+ * @brief Get the time the backend waits for the transaction with the
+ *      transactions chained after it, ONE_WIRE_TRANSACTION_TIMEOUT_MS each
+ * 
+ * @param transaction The first transaction
+ * @return uint32_t The timeout, ms
+ */
+uint32_t drv_one_wire_get_timeout_ms(xDrvOneWireTransaction_t const * transaction);
+
+/**
+ * @brief Build the header bytes of the transaction: ROM command, ROM and
+ *      function command, for the scripts that write the header themselves
+ * 
+ * @param transaction[in] The transaction
+ * @param header[out] The header, up to ONE_WIRE_HEADER_MAX bytes
+ * @return uint8_t The amount of header bytes
+ */
+uint8_t drv_one_wire_build_header(xDrvOneWireTransaction_t const * transaction, uint8_t * header);
+
+/**
+ * @brief Get the error counters of the bus
+ * 
+ * @param bus The bus
+ * @return xDrvOneWireStats_t const* The counters
+ */
+xDrvOneWireStats_t const * drv_one_wire_get_stats(xDrvOneWireBus_t * bus);
+
+/**
+ * @brief Configure the strong pull-up pin of the bus. The pin is push-pull
+ *      output driving P-channel MOSFET gate, low level enables the pull-up
+ * 
+ * @param bus The bus to use
+ * @param port The port of the pin
+ * @param pin The pin number
+ */
+void drv_one_wire_strong_pullup_init(xDrvOneWireBus_t * bus, GPIO_TypeDef * port, uint8_t pin);
+
+/**
+ * @brief Enable or disable the strong pull-up of the bus. Must be enabled
+ *      within 10 us of the last slot of the command that needs power, which
+ *      a task can't guarantee, so DOW_STEP_PULLUP has the backend enable it.
+ *      Disable it before the next slot
+ * 
+ * @param bus The bus to use
+ * @param is_enabled TRUE to enable
+ * @return result_t RESULT_OK if the bus has the strong pull-up
+ */
+result_t drv_one_wire_strong_pullup(xDrvOneWireBus_t * bus, BOOL is_enabled);
+
+/**
+ * @brief Set the speed of the following slots and reset pulses. Devices
+ *      must be switched to overdrive before with drv_one_wire_overdrive_skip_rom()
+ *      or drv_one_wire_overdrive_match_rom()
+ * 
+ * @param bus The bus to use
+ * @param speed The speed
+ * @return result_t RESULT_OK if the backend supports the speed
+ */
+result_t drv_one_wire_set_speed(xDrvOneWireBus_t * bus, eDrvOneWireSpeed_t speed);
+
+/**
+ * @brief Switch all overdrive capable devices to overdrive with Overdrive Skip
+ *      ROM and leave the bus at overdrive if any of them answers the overdrive
+ *      reset. Otherwise the bus and the devices are returned to standard speed
+ * 
+ * @param bus The bus to use
+ * @return eDrvOneWireSpeed_t The speed the bus was left at
+ */
+eDrvOneWireSpeed_t drv_one_wire_overdrive_skip_rom(xDrvOneWireBus_t * bus);
+
+/**
+ * @brief Switch the device to overdrive with Overdrive Match ROM and leave the
+ *      bus at overdrive if the device answers the overdrive reset. The reset
+ *      deselects the device, so address it again with Match ROM at overdrive.
+ *      Devices that don't answer are returned to standard speed
+ * 
+ * @param bus The bus to use
+ * @param rom The ROM of the device
+ * @return eDrvOneWireSpeed_t The speed the bus was left at
+ */
+eDrvOneWireSpeed_t drv_one_wire_overdrive_match_rom(xDrvOneWireBus_t * bus, uint8_t const * rom);
+
+/**
+ * @brief Execute the list of steps back to back. Reset, write and read steps
+ *      are merged into transactions chained together, the whole chain is one
+ *      backend submission, up to ONE_WIRE_SCRIPT_MAX_CHAIN transactions.
+ *      Pull-up and delay steps are executed between the chains, the strong
+ *      pull-up is enabled by the backend right after the chain before it
+ * 
+ * @param bus The bus to use
+ * @param steps[in/out] The steps to execute, read steps get the data
+ * @param count The amount of steps
+ * @return result_t RESULT_OK if all steps completed, otherwise the result
+ *      of the failed step, the rest of the script is skipped
+ */
+result_t drv_one_wire_script(xDrvOneWireBus_t * bus, xDrvOneWireStep_t const * steps, uint16_t count);
+
+/**
+ * @brief Execute the transaction slot by slot with reset and touch_bit
+ *      operations of the backend. Used by backends before the scheduler starts
+ * 
+ * @param ops The backend operations
+ * @param hw The backend instance
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed, otherwise the
+ *      result of the failed reset or slot
+ */
+result_t drv_one_wire_polled_transaction(xDrvOneWireOps_t const * ops, void * hw, xDrvOneWireTransaction_t * transaction);
+
+/**
+ * @brief Prepare the cursor to walk the transaction
+ * 
+ * @param cursor[out] The cursor
+ * @param transaction[in] The transaction
+ */
+void drv_one_wire_cursor_init(xDrvOneWireCursor_t * cursor, xDrvOneWireTransaction_t * transaction);
+
+/**
+ * @brief Get the next slot to send
+ * 
+ * @param cursor The cursor
+ * @return eDrvOneWireSlot_t The slot, DOW_SLOT_NONE if nothing left to send
+ */
+eDrvOneWireSlot_t drv_one_wire_cursor_next_slot(xDrvOneWireCursor_t * cursor);
+
+/**
+ * @brief Get the slot drv_one_wire_cursor_next_slot() returns next without
+ *      moving the cursor
+ * 
+ * @param cursor The cursor
+ * @return eDrvOneWireSlot_t The slot, DOW_SLOT_NONE if nothing left to send
+ */
+eDrvOneWireSlot_t drv_one_wire_cursor_peek_slot(xDrvOneWireCursor_t * cursor);
+
+/**
+ * @brief Store the sampled line state of the oldest slot in flight. After
+ *      the last slot enables the strong pull-up of the last transaction
+ * 
+ * @param cursor The cursor
+ * @param sampled The line state, for reset slot TRUE if presence was detected
+ * @return result_t RESULT_NOTHING while more slots are expected, RESULT_OK
+ *      when the last slot completed, RESULT_NO_DEVICE if there was no presence
+ */
+result_t drv_one_wire_cursor_complete_slot(xDrvOneWireCursor_t * cursor, uint8_t sampled);
+
+#endif  //_DRV_ONE_WIRE_
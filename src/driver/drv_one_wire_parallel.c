@@ -0,0 +1,482 @@
+/**
+ * @file drv_one_wire_parallel.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Parallel 1-wire master for up to 16 buses on one GPIO port for
+ *      stm32f103xx series. TIM1 paces the slots and its DMA requests write
+ *      precomputed words to GPIOx->BSRR and sample GPIOx->IDR, so every slot
+ *      runs on all buses at the same time
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "drv_one_wire_parallel.h"
+#include "drv_clocks.h"
+#include "drv_dma.h"
+#include "drv_dwt.h"
+#include "config.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define PAR_TIMER_NO                1
+#define PAR_TICK_HZ                 1000000
+#define PAR_BITS_PER_BYTE           8
+#define PAR_MAX_SLOTS               (ONE_WIRE_PARALLEL_MAX_BYTES * PAR_BITS_PER_BYTE)
+
+// TIM1 DMA requests
+#define PAR_DMA_PULL                DD_CHANNEL_5    //TIM1_UP
+#define PAR_DMA_RELEASE             DD_CHANNEL_2    //TIM1_CH1
+#define PAR_DMA_SAMPLE              DD_CHANNEL_3    //TIM1_CH2
+#define PAR_DMA_RELEASE_ALL         DD_CHANNEL_4    //TIM1_CH4
+
+// Slot timings, us from the slot start. The release all event ends the run
+// so it must come after the sample
+typedef struct
+{
+    uint16_t period;        //Slot length
+    uint16_t release;       //Buses sending 1 are released
+    uint16_t sample;        //IDR is sampled
+    uint16_t release_all;   //All buses are released
+} xParTiming_t;
+
+static const xParTiming_t _reset_timing = {
+    .period = 960,
+    .release = 480,
+    .sample = 480 + 70,
+    .release_all = 900      //Already released by the release word
+};
+
+static const xParTiming_t _slot_timing = {
+    .period = 70,
+    .release = 6,
+    .sample = 13,
+    .release_all = 60
+};
+
+static struct
+{
+    uint32_t release[PAR_MAX_SLOTS];
+    uint16_t samples[PAR_MAX_SLOTS];
+    uint32_t pull_word;                 //BSRR word of the slot start
+    uint32_t release_all_word;          //BSRR word of the low phase end
+    TaskHandle_t task;
+} _cxt;
+
+static result_t _reset(void * hw);
+static result_t _touch_bit(void * hw, uint8_t bit, uint8_t * sampled);
+static result_t _transaction(void * hw, xDrvOneWireTransaction_t * transaction);
+
+const xDrvOneWireOps_t drv_one_wire_parallel_ops = {
+    .reset = _reset,
+    .touch_bit = _touch_bit,
+    .transaction = _transaction
+};
+
+/**
+ * @brief Build the per slot BSRR words that release the buses sending 1
+ * 
+ * @param pins The buses in use
+ * @param data[in] Bytes of all buses
+ * @param length The amount of bytes per bus
+ * @param release[out] BSRR words, length * 8 items
+ */
+void drv_one_wire_parallel_build_release(uint16_t pins, xDrvOneWireParallelData_t const * data, uint8_t length, uint32_t * release)
+{
+    for (uint8_t byte = 0; byte < length; byte++)
+    {
+        for (uint8_t bit = 0; bit < PAR_BITS_PER_BYTE; bit++)
+        {
+            uint32_t word = 0;
+
+            for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+            {
+                if ((pins & (1 << pin)) && ((data[byte][pin] >> bit) & 0x01))
+                {
+                    word |= 1 << pin;
+                }
+            }
+
+            *release++ = word;
+        }
+    }
+}
+
+/**
+ * @brief Unpack sampled IDR words into bytes of every bus
+ * 
+ * @param pins The buses in use
+ * @param samples[in] IDR words, one per slot, length * 8 items
+ * @param length The amount of bytes per bus
+ * @param data[out] Bytes of all buses. Bytes of the buses out of the mask
+ *      are not touched
+ */
+void drv_one_wire_parallel_unpack(uint16_t pins, uint16_t const * samples, uint8_t length, xDrvOneWireParallelData_t * data)
+{
+    for (uint8_t byte = 0; byte < length; byte++)
+    {
+        for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+        {
+            if (pins & (1 << pin))
+            {
+                data[byte][pin] = 0;
+            }
+        }
+
+        for (uint8_t bit = 0; bit < PAR_BITS_PER_BYTE; bit++)
+        {
+            uint16_t sample = *samples++ & pins;
+
+            for (uint8_t pin = 0; sample; pin++, sample >>= 1)
+            {
+                if (sample & 0x01)
+                {
+                    data[byte][pin] |= 1 << bit;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Enable the port clock and configure the bus pins as general
+ *      purpose open-drain outputs released high
+ * 
+ * @param parallel The parallel master
+ */
+static void _init(xDrvOneWireParallel_t * parallel)
+{
+    GPIO_TypeDef * port = parallel->port;
+    TIM_TypeDef * timer = TIM1;
+
+    if (port == GPIOA)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_IOPAEN;
+    }
+    else if (port == GPIOB)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_IOPBEN;
+    }
+    else if (port == GPIOC)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_IOPCEN;
+    }
+
+    port->BSRR = parallel->pins;
+
+    for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+    {
+        if (parallel->pins & (1 << pin))
+        {
+            volatile uint32_t * cr = (pin < 8) ? &port->CRL : &port->CRH;
+            uint32_t shift = (pin % 8) * 4;
+
+            //Output 2MHz, general purpose open-drain
+            *cr = (*cr & ~(0xFUL << shift)) | ((GPIO_CRL_MODE0_1 | GPIO_CRL_CNF0_0) << shift);
+        }
+    }
+
+    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+
+    // Compare channels are used only as DMA triggers, no outputs
+    timer->CR1 = TIM_CR1_URS;
+    timer->DIER = 0;
+    timer->CCMR1 = 0;
+    timer->CCMR2 = 0;
+    timer->CCER = 0;
+    timer->PSC = drv_clocks_get_timxclk(PAR_TIMER_NO) / PAR_TICK_HZ - 1;
+    timer->EGR = TIM_EGR_UG;
+    timer->SR = 0;
+
+    parallel->is_inited = TRUE;
+}
+
+/**
+ * @brief Called when the last low phase has ended, stops the timer and
+ *      wakes up the task
+ * 
+ * @param arg Unused
+ * @param result Transfer result
+ */
+static void _on_release_all_complete(void * arg, result_t result)
+{
+    BaseType_t is_higher_priority_task_woken = pdFALSE;
+
+    (void)arg;
+    (void)result;
+
+    TIM1->CR1 &= ~TIM_CR1_CEN;
+    TIM1->DIER = 0;
+
+    vTaskNotifyGiveFromISR(_cxt.task, &is_higher_priority_task_woken);
+    portYIELD_FROM_ISR(is_higher_priority_task_woken);
+}
+
+/**
+ * @brief Run the prepared slots on all buses of the mask. Release words must
+ *      be in _cxt.release, samples are stored to _cxt.samples.
+ *      The pull low DMA request stops after the last slot so the buses stay
+ *      released while the timer is being stopped
+ * 
+ * @param parallel The parallel master
+ * @param pins The buses to use
+ * @param timing The slot timing
+ * @param count The amount of slots
+ * @return result_t RESULT_OK if all slots were sent, RESULT_TIMEOUT if DMA
+ *      did not finish in time, the buses are released then
+ */
+static result_t _run(xDrvOneWireParallel_t * parallel, uint16_t pins, xParTiming_t const * timing, uint16_t count)
+{
+    TIM_TypeDef * timer = TIM1;
+    BOOL is_sleeping = (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+    BOOL is_complete = TRUE;
+    xDrvDmaTransfer_t transfer = {
+        .direction = DD_DIR_MEM_TO_PERIPH,
+        .periph_size = DD_SIZE_32,
+        .mem_size = DD_SIZE_32,
+        .periph_addr = &parallel->port->BSRR,
+        .count = count
+    };
+
+    if (!parallel->is_inited)
+    {
+        _init(parallel);
+    }
+
+    _cxt.pull_word = (uint32_t)pins << 16;
+    _cxt.release_all_word = pins;
+
+    timer->CR1 &= ~TIM_CR1_CEN;
+    timer->DIER = 0;
+    timer->ARR = timing->period - 1;
+    timer->CCR1 = timing->release;
+    timer->CCR2 = timing->sample;
+    timer->CCR4 = timing->release_all;
+
+    transfer.priority = DD_PRIORITY_VERY_HIGH;
+    transfer.mem_addr = &_cxt.pull_word;
+    transfer.mem_increment = FALSE;
+    drv_dma_start(PAR_DMA_PULL, &transfer);
+
+    transfer.mem_addr = _cxt.release;
+    transfer.mem_increment = TRUE;
+    drv_dma_start(PAR_DMA_RELEASE, &transfer);
+
+    transfer.priority = DD_PRIORITY_HIGH;
+    transfer.mem_addr = &_cxt.release_all_word;
+    transfer.mem_increment = FALSE;
+    if (is_sleeping)
+    {
+        transfer.callback = _on_release_all_complete;
+        _cxt.task = xTaskGetCurrentTaskHandle();
+        ulTaskNotifyTake(pdTRUE, 0);
+    }
+    drv_dma_start(PAR_DMA_RELEASE_ALL, &transfer);
+
+    transfer.direction = DD_DIR_PERIPH_TO_MEM;
+    transfer.periph_size = DD_SIZE_16;
+    transfer.mem_size = DD_SIZE_16;
+    transfer.priority = DD_PRIORITY_HIGH;
+    transfer.periph_addr = &parallel->port->IDR;
+    transfer.mem_addr = _cxt.samples;
+    transfer.mem_increment = TRUE;
+    transfer.callback = 0;
+    drv_dma_start(PAR_DMA_SAMPLE, &transfer);
+
+    // The first overflow comes on the next tick and starts the first slot
+    timer->CNT = timing->period - 1;
+    timer->SR = 0;
+    timer->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE | TIM_DIER_CC2DE | TIM_DIER_CC4DE;
+    timer->CR1 |= TIM_CR1_CEN;
+
+    if (is_sleeping)
+    {
+        is_complete = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ONE_WIRE_TRANSACTION_TIMEOUT_MS)) ? TRUE : FALSE;
+    }
+    else
+    {
+        uint32_t deadline = drv_dwt_get_deadline(count * timing->period + ONE_WIRE_SLOT_TIMEOUT_US);
+
+        while (!(is_complete = drv_dma_is_complete(PAR_DMA_RELEASE_ALL)) && !drv_dwt_is_expired(deadline));
+    }
+
+    timer->CR1 &= ~TIM_CR1_CEN;
+    timer->DIER = 0;
+
+    drv_dma_stop(PAR_DMA_PULL);
+    drv_dma_stop(PAR_DMA_RELEASE);
+    drv_dma_stop(PAR_DMA_SAMPLE);
+    drv_dma_stop(PAR_DMA_RELEASE_ALL);
+
+    if (!is_complete)
+    {
+        // Stopped in the middle of the slot, don't leave the buses low
+        parallel->port->BSRR = pins;
+        DEBUG_PRINT("1-Wire: parallel run timeout");
+        return RESULT_TIMEOUT;
+    }
+
+    return RESULT_OK;
+}
+
+/**
+ * @brief Send reset pulse on all buses of the mask at once
+ * 
+ * @param parallel The parallel master
+ * @param pins The buses to reset, subset of parallel->pins
+ * @return uint16_t The mask of buses where presence pulse was detected,
+ *      0 if the run timed out
+ */
+uint16_t drv_one_wire_parallel_reset(xDrvOneWireParallel_t * parallel, uint16_t pins)
+{
+    pins &= parallel->pins;
+
+    _cxt.release[0] = pins;
+    if (_run(parallel, pins, &_reset_timing, 1) != RESULT_OK)
+    {
+        return 0;
+    }
+
+    return ~_cxt.samples[0] & pins;
+}
+
+/**
+ * @brief Send bytes on all buses of the mask at once and read the line back.
+ *      Every bus gets its own bytes, send 0xFF to read
+ * 
+ * @param parallel The parallel master
+ * @param pins The buses to use, subset of parallel->pins
+ * @param data[in/out] Bytes to send, replaced with sampled bytes
+ * @param length The amount of bytes per bus
+ * @return result_t RESULT_OK if all slots were sent, RESULT_TIMEOUT if the
+ *      run did not finish in time
+ */
+result_t drv_one_wire_parallel_touch(xDrvOneWireParallel_t * parallel, uint16_t pins, xDrvOneWireParallelData_t * data, uint8_t length)
+{
+    result_t result = RESULT_OK;
+
+    pins &= parallel->pins;
+
+    while (length && result == RESULT_OK)
+    {
+        uint8_t chunk = MIN(length, ONE_WIRE_PARALLEL_MAX_BYTES);
+
+        drv_one_wire_parallel_build_release(pins, data, chunk, _cxt.release);
+        result = _run(parallel, pins, &_slot_timing, chunk * PAR_BITS_PER_BYTE);
+        if (result == RESULT_OK)
+        {
+            drv_one_wire_parallel_unpack(pins, _cxt.samples, chunk, data);
+        }
+
+        data += chunk;
+        length -= chunk;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Performs PRESENSE pulse on one bus of the parallel master
+ * 
+ * @param hw The bus pin handle
+ * @return result_t RESULT_OK on presence, RESULT_NO_DEVICE without it,
+ *      RESULT_TIMEOUT if the run did not finish in time
+ */
+static result_t _reset(void * hw)
+{
+    xDrvOneWireParallelPin_t * bus = (xDrvOneWireParallelPin_t *) hw;
+    uint16_t pin = (1 << bus->pin) & bus->parallel->pins;
+
+    _cxt.release[0] = pin;
+    if (_run(bus->parallel, pin, &_reset_timing, 1) != RESULT_OK)
+    {
+        return RESULT_TIMEOUT;
+    }
+
+    return (!pin || (_cxt.samples[0] & pin)) ? RESULT_NO_DEVICE : RESULT_OK;
+}
+
+/**
+ * @brief Sends a slot on one bus of the parallel master and reads back the
+ *      line state
+ * 
+ * @param hw The bus pin handle
+ * @param bit The bit to send, 1 for read slot
+ * @param sampled[out] Read bit
+ * @return result_t RESULT_OK if the slot was sent
+ */
+static result_t _touch_bit(void * hw, uint8_t bit, uint8_t * sampled)
+{
+    xDrvOneWireParallelPin_t * bus = (xDrvOneWireParallelPin_t *) hw;
+    uint16_t pin = (1 << bus->pin) & bus->parallel->pins;
+
+    _cxt.release[0] = bit ? pin : 0;
+    if (_run(bus->parallel, pin, &_slot_timing, 1) != RESULT_OK)
+    {
+        return RESULT_TIMEOUT;
+    }
+
+    *sampled = (_cxt.samples[0] & pin) ? 1 : 0;
+
+    return RESULT_OK;
+}
+
+/**
+ * @brief Execute the transaction with the chained ones on one bus of the
+ *      parallel master. Reset pulses run alone, the slots between them are
+ *      sent in blocks of up to PAR_MAX_SLOTS
+ * 
+ * @param hw The bus pin handle
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed,
+ *      RESULT_NO_DEVICE if there was no presence pulse, RESULT_TIMEOUT if
+ *      the run did not finish in time
+ */
+static result_t _transaction(void * hw, xDrvOneWireTransaction_t * transaction)
+{
+    xDrvOneWireParallelPin_t * bus = (xDrvOneWireParallelPin_t *) hw;
+    uint16_t pin = (1 << bus->pin) & bus->parallel->pins;
+    xDrvOneWireCursor_t cursor;
+    result_t result = RESULT_NOTHING;
+    eDrvOneWireSlot_t slot;
+
+    drv_one_wire_cursor_init(&cursor, transaction);
+
+    while (result == RESULT_NOTHING && (slot = drv_one_wire_cursor_peek_slot(&cursor)) != DOW_SLOT_NONE)
+    {
+        uint16_t count = 0;
+
+        if (slot == DOW_SLOT_RESET)
+        {
+            result = _reset(hw);
+            if (result == RESULT_TIMEOUT)
+            {
+                return result;
+            }
+
+            drv_one_wire_cursor_next_slot(&cursor);
+            result = drv_one_wire_cursor_complete_slot(&cursor, result == RESULT_OK);
+            continue;
+        }
+
+        while (count < PAR_MAX_SLOTS && (slot = drv_one_wire_cursor_peek_slot(&cursor)) != DOW_SLOT_NONE &&
+            slot != DOW_SLOT_RESET)
+        {
+            drv_one_wire_cursor_next_slot(&cursor);
+            _cxt.release[count++] = (slot == DOW_SLOT_1) ? pin : 0;
+        }
+
+        if (_run(bus->parallel, pin, &_slot_timing, count) != RESULT_OK)
+        {
+            return RESULT_TIMEOUT;
+        }
+
+        for (uint16_t i = 0; i < count && result == RESULT_NOTHING; i++)
+        {
+            result = drv_one_wire_cursor_complete_slot(&cursor, (_cxt.samples[i] & pin) ? 1 : 0);
+        }
+    }
+
+    return (result == RESULT_NO_DEVICE) ? RESULT_NO_DEVICE : RESULT_OK;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/**
+ * @file drv_one_wire_parallel.h
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Parallel 1-wire master for up to 16 buses on one GPIO port for
+ *      stm32f103xx series. TIM1 paces the slots and its DMA requests write
+ *      precomputed words to GPIOx->BSRR and sample GPIOx->IDR, so every slot
+ *      runs on all buses at the same time:
+ *          UP  (DMA1 Ch5) - pull all buses low, slot start
+ *          CC1 (DMA1 Ch2) - release buses sending 1 (per slot word)
+ *          CC2 (DMA1 Ch3) - sample IDR
+ *          CC4 (DMA1 Ch4) - release all buses, end of low phase
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef _DRV_ONE_WIRE_PARALLEL_
+#define _DRV_ONE_WIRE_PARALLEL_
+
+#include "drv_one_wire.h"
+
+#define ONE_WIRE_PARALLEL_BUS_NUM       16
+
+typedef struct
+{
+    GPIO_TypeDef *  port;
+    uint16_t        pins;           //Mask of the port pins, one bus per pin
+    BOOL            is_inited;
+} xDrvOneWireParallel_t;
+
+// One bus of the parallel master used through the common bus operations
+typedef struct
+{
+    xDrvOneWireParallel_t * parallel;
+    uint8_t                 pin;
+} xDrvOneWireParallelPin_t;
+
+// Bytes of all buses, data[byte][pin]
+typedef uint8_t xDrvOneWireParallelData_t[ONE_WIRE_PARALLEL_BUS_NUM];
+
+extern const xDrvOneWireOps_t drv_one_wire_parallel_ops;
+
+/**
+ * @brief Send reset pulse on all buses of the mask at once
+ * 
+ * @param parallel The parallel master
+ * @param pins The buses to reset, subset of parallel->pins
+ * @return uint16_t The mask of buses where presence pulse was detected
+ */
+uint16_t drv_one_wire_parallel_reset(xDrvOneWireParallel_t * parallel, uint16_t pins);
+
+/**
+ * @brief Send bytes on all buses of the mask at once and read the line back.
+ *      Every bus gets its own bytes, send 0xFF to read
+ * 
+ * @param parallel The parallel master
+ * @param pins The buses to use, subset of parallel->pins
+ * @param data[in/out] Bytes to send, replaced with sampled bytes
+ * @param length The amount of bytes per bus
+ * @return result_t RESULT_OK if all slots were sent
+ */
+result_t drv_one_wire_parallel_touch(xDrvOneWireParallel_t * parallel, uint16_t pins, xDrvOneWireParallelData_t * data, uint8_t length);
+
+/**
+ * @brief Build the per slot BSRR words that release the buses sending 1
+ * 
+ * @param pins The buses in use
+ * @param data[in] Bytes of all buses
+ * @param length The amount of bytes per bus
+ * @param release[out] BSRR words, length * 8 items
+ */
+void drv_one_wire_parallel_build_release(uint16_t pins, xDrvOneWireParallelData_t const * data, uint8_t length, uint32_t * release);
+
+/**
+ * @brief Unpack sampled IDR words into bytes of every bus
+ * 
+ * @param pins The buses in use
+ * @param samples[in] IDR words, one per slot, length * 8 items
+ * @param length The amount of bytes per bus
+ * @param data[out] Bytes of all buses. Bytes of the buses out of the mask
+ *      are not touched
+ */
+void drv_one_wire_parallel_unpack(uint16_t pins, uint16_t const * samples, uint8_t length, xDrvOneWireParallelData_t * data);
+
+#endif  //_DRV_ONE_WIRE_PARALLEL_
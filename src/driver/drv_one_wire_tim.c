@@ -0,0 +1,415 @@
+/**
+ * @file drv_one_wire_tim.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief 1-wire bus backend on general purpose timer for stm32f103xx series.
+ *      Channel 1 drives the open-drain pin in PWM mode, channel 2 captures
+ *      the rising edges of the same pin (IC2 mapped on TI1). The timer ticks
+ *      at 1 MHz so every slot is timed with microsecond resolution
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "drv_one_wire_tim.h"
+#include "stm32f103xb.h"
+#include "drv_clocks.h"
+#include "drv_dwt.h"
+#include "config.h"
+
+#define TIM_TICK_HZ                 1000000
+#define TIM_NUM                     5
+
+// Standard speed timings, us
+#define TIM_RESET_LOW_US            480
+#define TIM_RESET_SLOT_US           960
+#define TIM_PRESENCE_MIN_US         15      //Device never answers earlier after the release
+#define TIM_WRITE_0_LOW_US          60
+#define TIM_WRITE_1_LOW_US          6
+#define TIM_SLOT_US                 70
+#define TIM_SAMPLE_US               15
+#define TIM_IDLE_US                 10
+
+// PWM mode 1 on OC1 with active low polarity: the line is pulled low while CNT < CCR1
+#define TIM_CCMR1_OC1_PWM1          (TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1)
+#define TIM_CCMR1_IC2_ON_TI1        TIM_CCMR1_CC2S_1
+
+static xDrvOneWireTim_t * _instances[TIM_NUM];
+
+static result_t _reset(void * hw);
+static result_t _touch_bit(void * hw, uint8_t bit, uint8_t * sampled);
+static result_t _transaction(void * hw, xDrvOneWireTransaction_t * transaction);
+
+const xDrvOneWireOps_t drv_one_wire_tim_ops = {
+    .reset = _reset,
+    .touch_bit = _touch_bit,
+    .transaction = _transaction
+};
+
+/**
+ * @brief Get the pointer to the base register address for the timer
+ * 
+ * @param timer_no Timer number
+ * @return TIM_TypeDef* The pointer to the base register address
+ */
+static TIM_TypeDef * _get_timer_registers_struct(uint32_t timer_no)
+{
+    TIM_TypeDef * timer = 0;
+
+    switch (timer_no)
+    {
+        case 2: timer = TIM2; break;
+        case 3: timer = TIM3; break;
+        case 4: timer = TIM4; break;
+    }
+
+    return timer;
+}
+
+/**
+ * @brief Configure the timer channel 1 pin as alternate function open-drain
+ * 
+ * @param port The port of the pin
+ * @param pin The pin number
+ */
+static void _init_pin(GPIO_TypeDef * port, uint8_t pin)
+{
+    volatile uint32_t * cr = (pin < 8) ? &port->CRL : &port->CRH;
+    uint32_t shift = (pin % 8) * 4;
+
+    if (port == GPIOA)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_IOPAEN;
+    }
+    else if (port == GPIOB)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_IOPBEN;
+    }
+    else if (port == GPIOC)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_IOPCEN;
+    }
+    RCC->APB2ENR |= RCC_APB2ENR_AFIOEN;
+
+    //Output 2MHz, alternate open-drain
+    *cr = (*cr & ~(0xFUL << shift)) | ((GPIO_CRL_MODE0_1 | GPIO_CRL_CNF0_1 | GPIO_CRL_CNF0_0) << shift);
+}
+
+/**
+ * @brief Write slot timings to the timer. With preload enabled they take
+ *      effect on the next update event
+ * 
+ * @param timer The timer registers
+ * @param slot The slot
+ */
+static void _load(TIM_TypeDef * timer, eDrvOneWireSlot_t slot)
+{
+    switch (slot)
+    {
+        case DOW_SLOT_RESET:
+            timer->CCR1 = TIM_RESET_LOW_US;
+            timer->ARR = TIM_RESET_SLOT_US - 1;
+            break;
+        case DOW_SLOT_0:
+            timer->CCR1 = TIM_WRITE_0_LOW_US;
+            timer->ARR = TIM_SLOT_US - 1;
+            break;
+        case DOW_SLOT_1:
+            timer->CCR1 = TIM_WRITE_1_LOW_US;
+            timer->ARR = TIM_SLOT_US - 1;
+            break;
+        default:
+            timer->CCR1 = 0;
+            timer->ARR = TIM_IDLE_US - 1;
+            break;
+    }
+}
+
+/**
+ * @brief Decode the line state of the finished slot from the last captured
+ *      rising edge
+ * 
+ * @param slot The finished slot
+ * @param sr Timer status register at the end of the slot
+ * @param capture The last captured rising edge time, us from the slot start
+ * @return uint8_t The bit, for reset slot 1 if presence pulse was detected
+ */
+static uint8_t _sample(eDrvOneWireSlot_t slot, uint32_t sr, uint32_t capture)
+{
+    if (!(sr & TIM_SR_CC2IF))
+    {
+        return 0;
+    }
+
+    if (slot == DOW_SLOT_RESET)
+    {
+        // The last rising edge is the end of presence pulse if any device answered
+        return capture >= TIM_RESET_LOW_US + TIM_PRESENCE_MIN_US;
+    }
+
+    return capture < TIM_SAMPLE_US;
+}
+
+/**
+ * @brief Check the finished slot for the line held low. Every slot and reset
+ *      releases the line before its end, so a working bus always has
+ *      a rising edge captured
+ * 
+ * @param sr Timer status register at the end of the slot
+ * @return BOOL TRUE if the line was low for the whole slot
+ */
+static BOOL _is_line_stuck(uint32_t sr)
+{
+    return (sr & TIM_SR_CC2IF) ? FALSE : TRUE;
+}
+
+/**
+ * @brief Timer and pin initialization
+ * 
+ * @param tim The backend instance
+ */
+static void _init(xDrvOneWireTim_t * tim)
+{
+    TIM_TypeDef * timer = _get_timer_registers_struct(tim->timer_no);
+    IRQn_Type irq = TIM2_IRQn;
+
+    ASSERT("1-Wire timer is not supported", timer != 0);
+
+    switch (tim->timer_no)
+    {
+        case 2: RCC->APB1ENR |= RCC_APB1ENR_TIM2EN; irq = TIM2_IRQn; break;
+        case 3: RCC->APB1ENR |= RCC_APB1ENR_TIM3EN; irq = TIM3_IRQn; break;
+        case 4: RCC->APB1ENR |= RCC_APB1ENR_TIM4EN; irq = TIM4_IRQn; break;
+    }
+
+    _init_pin(tim->port, tim->pin);
+
+    timer->CR1 = 0;
+    timer->DIER = 0;
+    timer->PSC = drv_clocks_get_timxclk(tim->timer_no) / TIM_TICK_HZ - 1;
+    timer->CCMR1 = TIM_CCMR1_OC1_PWM1 | TIM_CCMR1_OC1PE | TIM_CCMR1_IC2_ON_TI1;
+    timer->CCER = TIM_CCER_CC1E | TIM_CCER_CC1P | TIM_CCER_CC2E;
+    _load(timer, DOW_SLOT_NONE);
+    timer->EGR = TIM_EGR_UG;
+    timer->CR1 = TIM_CR1_ARPE | TIM_CR1_URS;
+    timer->SR = 0;
+
+    _instances[tim->timer_no] = tim;
+    tim->running = DOW_SLOT_NONE;
+    tim->preloaded = DOW_SLOT_NONE;
+
+    NVIC_SetPriority(irq, IRQ_PRIORITY_ONE_WIRE_TIM);
+    NVIC_EnableIRQ(irq);
+
+    tim->is_inited = TRUE;
+}
+
+/**
+ * @brief Send one slot and wait for its end polling the update flag
+ * 
+ * @param tim The backend instance
+ * @param slot The slot to send
+ * @param sampled[out] Sampled line state
+ * @return result_t RESULT_OK if the slot was sent, RESULT_TIMEOUT if the
+ *      timer did not finish it, RESULT_BUS_ERROR if the line is held low
+ */
+static result_t _touch_slot(xDrvOneWireTim_t * tim, eDrvOneWireSlot_t slot, uint8_t * sampled)
+{
+    TIM_TypeDef * timer = _get_timer_registers_struct(tim->timer_no);
+    uint32_t deadline;
+
+    if (!tim->is_inited)
+    {
+        _init(tim);
+    }
+
+    _load(timer, slot);
+    timer->EGR = TIM_EGR_UG;
+    _load(timer, DOW_SLOT_NONE);
+    timer->SR = 0;
+    timer->CR1 |= TIM_CR1_CEN;
+
+    deadline = drv_dwt_get_deadline(ONE_WIRE_SLOT_TIMEOUT_US);
+    while (!(timer->SR & TIM_SR_UIF) && !drv_dwt_is_expired(deadline));
+
+    uint32_t sr = timer->SR;
+    uint32_t capture = timer->CCR2;
+
+    timer->CR1 &= ~TIM_CR1_CEN;
+    timer->SR = 0;
+
+    if (!(sr & TIM_SR_UIF))
+    {
+        return RESULT_TIMEOUT;
+    }
+
+    *sampled = _sample(slot, sr, capture);
+
+    return _is_line_stuck(sr) ? RESULT_BUS_ERROR : RESULT_OK;
+}
+
+/**
+ * @brief Performs PRESENSE pulse on 1-Wire line (reset pulse)
+ * 
+ * @param hw The backend instance
+ * @return result_t RESULT_OK on presence, RESULT_NO_DEVICE without it,
+ *      RESULT_TIMEOUT or RESULT_BUS_ERROR if the line failed
+ */
+static result_t _reset(void * hw)
+{
+    uint8_t presence = 0;
+    result_t res = _touch_slot((xDrvOneWireTim_t *) hw, DOW_SLOT_RESET, &presence);
+
+    if (res == RESULT_OK && !presence)
+    {
+        res = RESULT_NO_DEVICE;
+    }
+
+    return res;
+}
+
+/**
+ * @brief Sends a slot and reads back the line state
+ * 
+ * @param hw The backend instance
+ * @param bit The bit to send, 1 for read slot
+ * @param sampled[out] Read bit
+ * @return result_t RESULT_OK if the slot was sent
+ */
+static result_t _touch_bit(void * hw, uint8_t bit, uint8_t * sampled)
+{
+    return _touch_slot((xDrvOneWireTim_t *) hw, bit ? DOW_SLOT_1 : DOW_SLOT_0, sampled);
+}
+
+/**
+ * @brief Handle the update event: decode the slot that has just finished and
+ *      preload the slot after the one that has just started
+ * 
+ * @param tim The backend instance
+ * @return BOOL TRUE when the transaction is finished and the timer stopped
+ */
+static BOOL _step(xDrvOneWireTim_t * tim)
+{
+    TIM_TypeDef * timer = _get_timer_registers_struct(tim->timer_no);
+    uint32_t sr = timer->SR;
+    uint32_t capture = timer->CCR2;
+
+    timer->SR = ~(uint32_t)(TIM_SR_UIF | TIM_SR_CC2OF);
+
+    eDrvOneWireSlot_t finished = tim->running;
+    tim->running = tim->preloaded;
+
+    if (finished != DOW_SLOT_NONE && tim->result == RESULT_NOTHING)
+    {
+        if (_is_line_stuck(sr))
+        {
+            tim->result = RESULT_BUS_ERROR;
+        }
+        else
+        {
+            tim->result = drv_one_wire_cursor_complete_slot(&tim->cursor, _sample(finished, sr, capture));
+        }
+    }
+
+    tim->preloaded = (tim->result == RESULT_NOTHING) ? drv_one_wire_cursor_next_slot(&tim->cursor) : DOW_SLOT_NONE;
+    _load(timer, tim->preloaded);
+
+    if (tim->running == DOW_SLOT_NONE && tim->preloaded == DOW_SLOT_NONE)
+    {
+        timer->CR1 &= ~TIM_CR1_CEN;
+        timer->DIER = 0;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief Update interrupt handler of the timer used as 1-Wire master
+ * 
+ * @param timer_no The number of the timer that raised the interrupt
+ */
+void drv_one_wire_tim_irq_handler(uint32_t timer_no)
+{
+    xDrvOneWireTim_t * tim = (timer_no < TIM_NUM) ? _instances[timer_no] : 0;
+    TIM_TypeDef * timer = _get_timer_registers_struct(timer_no);
+
+    if (!tim || !(timer->SR & TIM_SR_UIF))
+    {
+        return;
+    }
+
+    if (_step(tim))
+    {
+        BaseType_t is_higher_priority_task_woken = pdFALSE;
+
+        if (tim->result == RESULT_NOTHING)
+        {
+            tim->result = RESULT_OK;
+        }
+
+        vTaskNotifyGiveFromISR(tim->task, &is_higher_priority_task_woken);
+        portYIELD_FROM_ISR(is_higher_priority_task_woken);
+    }
+}
+
+/**
+ * @brief Execute the transaction with the chained ones. Slots go back to
+ *      back, the first two are loaded here and every update interrupt decodes
+ *      the finished slot and preloads the next one. The calling task sleeps
+ *      until the last slot or the timeout
+ * 
+ * @param hw The backend instance
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed,
+ *      RESULT_NO_DEVICE if there was no presence pulse, RESULT_TIMEOUT if
+ *      the timer stopped, RESULT_BUS_ERROR if the line is held low
+ */
+static result_t _transaction(void * hw, xDrvOneWireTransaction_t * transaction)
+{
+    xDrvOneWireTim_t * tim = (xDrvOneWireTim_t *) hw;
+    TIM_TypeDef * timer = _get_timer_registers_struct(tim->timer_no);
+
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        return drv_one_wire_polled_transaction(&drv_one_wire_tim_ops, hw, transaction);
+    }
+
+    if (!tim->is_inited)
+    {
+        _init(tim);
+    }
+
+    drv_one_wire_cursor_init(&tim->cursor, transaction);
+
+    tim->running = drv_one_wire_cursor_next_slot(&tim->cursor);
+    if (tim->running == DOW_SLOT_NONE)
+    {
+        return RESULT_OK;
+    }
+
+    tim->result = RESULT_NOTHING;
+    tim->task = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    _load(timer, tim->running);
+    timer->EGR = TIM_EGR_UG;
+    tim->preloaded = drv_one_wire_cursor_next_slot(&tim->cursor);
+    _load(timer, tim->preloaded);
+
+    timer->SR = 0;
+    timer->DIER = TIM_DIER_UIE;
+    timer->CR1 |= TIM_CR1_CEN;
+
+    if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(drv_one_wire_get_timeout_ms(transaction))))
+    {
+        timer->DIER = 0;
+        timer->CR1 &= ~TIM_CR1_CEN;
+        tim->running = DOW_SLOT_NONE;
+        tim->preloaded = DOW_SLOT_NONE;
+        DEBUG_PRINT("1-Wire: transaction timeout");
+        return RESULT_TIMEOUT;
+    }
+
+    return tim->result;
+}
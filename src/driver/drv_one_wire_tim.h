@@ -0,0 +1,49 @@
+/**
+ * @file drv_one_wire_tim.h
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief 1-wire bus backend on general purpose timer for stm32f103xx series.
+ *      Channel 1 drives the open-drain pin in PWM mode, channel 2 captures
+ *      the rising edges of the same pin (IC2 mapped on TI1). The timer ticks
+ *      at 1 MHz so every slot is timed with microsecond resolution
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef _DRV_ONE_WIRE_TIM_
+#define _DRV_ONE_WIRE_TIM_
+
+#include "drv_one_wire.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct
+{
+    // Configuration
+    uint32_t        timer_no;       //2, 3 or 4
+    GPIO_TypeDef *  port;           //Port of the timer channel 1 pin
+    uint8_t         pin;            //Timer channel 1 pin
+
+    // State
+    xDrvOneWireCursor_t cursor;
+    volatile eDrvOneWireSlot_t running;
+    volatile eDrvOneWireSlot_t preloaded;
+    volatile result_t result;
+    TaskHandle_t task;
+    BOOL is_inited;
+} xDrvOneWireTim_t;
+
+#define DRV_ONE_WIRE_TIM(timer, gpio_port, gpio_pin)    {.timer_no = (timer), .port = (gpio_port), .pin = (gpio_pin)}
+
+extern const xDrvOneWireOps_t drv_one_wire_tim_ops;
+
+/**
+ * @brief Update interrupt handler of the timer used as 1-Wire master
+ * 
+ * @param timer_no The number of the timer that raised the interrupt
+ */
+void drv_one_wire_tim_irq_handler(uint32_t timer_no);
+
+#endif  //_DRV_ONE_WIRE_TIM_
@@ -0,0 +1,663 @@
+/**
+ * @file drv_one_wire_usart.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief 1-wire bus backend on USART in half-duplex mode for stm32f103xx series.
+ *      Reset pulse is sent at 9600 baud, time slots at 120000 baud, at
+ *      overdrive speed at 70000 and 1000000 baud. Every
+ *      USART port is a separate bus, so buses run independently
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "drv_one_wire_usart.h"
+#include "stm32f103xb.h"
+#include "drv_dma.h"
+#include "drv_dwt.h"
+
+#include <string.h>
+
+#define ONE_WIRE_SLOT_BITS          ONE_WIRE_USART_SLOT_BITS
+#define ONE_WIRE_SLOT_ONE           0xFF
+#define ONE_WIRE_SLOT_ZERO          0x00
+#define ONE_WIRE_RESET_PULSE        0xF0
+#define ONE_WIRE_RESET_BAUDRATE     9600
+#define ONE_WIRE_SLOT_BAUDRATE      120000
+
+// Overdrive: 0xF0 gives 71 us reset pulse, 0x00 gives 9 us write 0 slot
+// and 0xFF gives 1 us write 1 slot sampled at 1.5 us. One stop bit leaves
+// 1 us of recovery between back to back slots, two give the 2 us minimum
+#define ONE_WIRE_OD_RESET_BAUDRATE  70000
+#define ONE_WIRE_OD_SLOT_BAUDRATE   1000000
+
+#if ONE_WIRE_USE_DMA && ONE_WIRE_DMA_MAX_BLOCK < ONE_WIRE_HEADER_MAX
+#error "ONE_WIRE_DMA_MAX_BLOCK must hold the Match ROM header in one transfer"
+#endif
+
+static result_t _reset(void * hw);
+static result_t _touch_bit(void * hw, uint8_t bit, uint8_t * sampled);
+static result_t _transaction(void * hw, xDrvOneWireTransaction_t * transaction);
+static result_t _set_speed(void * hw, eDrvOneWireSpeed_t speed);
+static void _init(xDrvOneWireUsart_t * ow);
+
+const xDrvOneWireOps_t drv_one_wire_usart_ops = {
+    .reset = _reset,
+    .touch_bit = _touch_bit,
+    .transaction = _transaction,
+    .set_speed = _set_speed
+};
+
+/**
+ * @brief Get the UART byte that makes the slot
+ * 
+ * @param slot The slot
+ * @return uint8_t The byte to send
+ */
+static uint8_t _slot_byte(eDrvOneWireSlot_t slot)
+{
+    switch (slot)
+    {
+        case DOW_SLOT_RESET:    return ONE_WIRE_RESET_PULSE;
+        case DOW_SLOT_0:        return ONE_WIRE_SLOT_ZERO;
+        default:                return ONE_WIRE_SLOT_ONE;
+    }
+}
+
+/**
+ * @brief Decode the line state from the echo of the slot byte. Reset pulse
+ *      echo is shortened by the presence pulse, time slot echo of anything
+ *      but ONE_WIRE_SLOT_ONE was pulled low by a device
+ * 
+ * @param slot The sent slot byte
+ * @param echo The received byte
+ * @return uint8_t The bit, for reset pulse 1 if presence was detected
+ */
+static uint8_t _sample(uint8_t slot, uint8_t echo)
+{
+    if (slot == ONE_WIRE_RESET_PULSE)
+    {
+        return (echo < ONE_WIRE_RESET_PULSE) ? 1 : 0;
+    }
+
+    return (echo == ONE_WIRE_SLOT_ONE) ? 1 : 0;
+}
+
+/**
+ * @brief Encode the next slots of the cursor into UART slot bytes, one byte
+ *      per slot: a reset pulse alone, as it needs its own baudrate, or the
+ *      time slots up to the next reset pulse
+ * 
+ * @param cursor The cursor, moved past the encoded slots
+ * @param slots[out] Slot bytes
+ * @param max The size of the slots buffer
+ * @return uint16_t The amount of slot bytes, 0 if nothing left to send
+ */
+uint16_t drv_one_wire_usart_encode_slots(xDrvOneWireCursor_t * cursor, uint8_t * slots, uint16_t max)
+{
+    eDrvOneWireSlot_t slot;
+    uint16_t count = 0;
+
+    while (count < max && (slot = drv_one_wire_cursor_peek_slot(cursor)) != DOW_SLOT_NONE)
+    {
+        if (slot == DOW_SLOT_RESET && count)
+        {
+            break;
+        }
+
+        slots[count++] = _slot_byte(drv_one_wire_cursor_next_slot(cursor));
+
+        if (slot == DOW_SLOT_RESET)
+        {
+            break;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Store the received echoes of the encoded slots to the cursor
+ * 
+ * @param cursor The cursor
+ * @param slots[in] Sent slot bytes
+ * @param echoes[in] Received bytes, one per slot
+ * @param count The amount of slots
+ * @return result_t RESULT_NOTHING while more slots are expected, RESULT_OK
+ *      when the last slot completed, RESULT_NO_DEVICE if there was no presence
+ */
+result_t drv_one_wire_usart_decode_slots(xDrvOneWireCursor_t * cursor, uint8_t const * slots, uint8_t const * echoes, uint16_t count)
+{
+    result_t result = RESULT_NOTHING;
+
+    for (uint16_t i = 0; i < count && result == RESULT_NOTHING; i++)
+    {
+        result = drv_one_wire_cursor_complete_slot(cursor, _sample(slots[i], echoes[i]));
+    }
+
+    return result;
+}
+
+/**
+ * @brief Check and clear framing error of the received echoes. The stop bit
+ *      is read low only if the line is held low for the whole frame
+ * 
+ * @param ow The backend instance
+ * @return BOOL TRUE if any echo since the last check had framing error
+ */
+static BOOL _is_framing_error(xDrvOneWireUsart_t * ow)
+{
+    return (drv_usart_take_rx_errors(ow->usart_no) & USART_SR_FE) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Send the byte and wait for its echo until the deadline
+ * 
+ * @param ow The backend instance
+ * @param ch The byte to send
+ * @param echo[out] The received echo
+ * @return result_t RESULT_OK if the echo was received, RESULT_TIMEOUT if not,
+ *      RESULT_BUS_ERROR if the echo had framing error
+ */
+static result_t _polled_echo(xDrvOneWireUsart_t * ow, uint8_t ch, uint8_t * echo)
+{
+    uint32_t deadline;
+    result_t res = RESULT_NOTHING;
+
+    // Drop the stale byte and its errors so we read the echo of our byte
+    drv_usart_getc(ow->usart_no, echo);
+    _is_framing_error(ow);
+
+    drv_usart_putc(ow->usart_no, ch);
+
+    deadline = drv_dwt_get_deadline(ONE_WIRE_SLOT_TIMEOUT_US);
+    while (res == RESULT_NOTHING && !drv_dwt_is_expired(deadline))
+    {
+        res = drv_usart_getc(ow->usart_no, echo);
+    }
+
+    if (res != RESULT_OK)
+    {
+        DEBUG_PRINT("1-Wire: no echo from the line");
+        return RESULT_TIMEOUT;
+    }
+
+    return _is_framing_error(ow) ? RESULT_BUS_ERROR : RESULT_OK;
+}
+
+/**
+ * @brief Sends a slot and reads back the line state
+ * 
+ * @param hw The backend instance
+ * @param bit The bit to send, 1 for read slot
+ * @param sampled[out] Read bit
+ * @return result_t RESULT_OK if the slot was sent
+ */
+static result_t _touch_bit(void * hw, uint8_t bit, uint8_t * sampled)
+{
+    xDrvOneWireUsart_t * ow = (xDrvOneWireUsart_t *) hw;
+    uint8_t read_usart_byte = ONE_WIRE_SLOT_ONE;
+    result_t res;
+
+    if (!ow->is_inited)
+    {
+        _init(ow);
+    }
+
+    res = _polled_echo(ow, bit ? ONE_WIRE_SLOT_ONE : ONE_WIRE_SLOT_ZERO, &read_usart_byte);
+    *sampled = (read_usart_byte == ONE_WIRE_SLOT_ONE) ? 1 : 0;
+
+    return res;
+}
+
+/**
+ * @brief Initialize the port at slot baudrate and precompute BRR values for
+ *      reset pulse and time slots
+ * 
+ * @param ow The backend instance
+ */
+static void _init(xDrvOneWireUsart_t * ow)
+{
+    xDrvUsartPortParams_t usart_params = {ow->usart_no, DU_DATA_BITS_8, DU_STOP_BITS_1, DU_NO_PARITY, ONE_WIRE_SLOT_BAUDRATE};
+
+    drv_usart_init_port(&usart_params);
+    ow->brr_reset[DOW_SPEED_STANDARD] = drv_usart_calculate_brr(ow->usart_no, ONE_WIRE_RESET_BAUDRATE);
+    ow->brr_slot[DOW_SPEED_STANDARD] = drv_usart_calculate_brr(ow->usart_no, ONE_WIRE_SLOT_BAUDRATE);
+    ow->brr_reset[DOW_SPEED_OVERDRIVE] = drv_usart_calculate_brr(ow->usart_no, ONE_WIRE_OD_RESET_BAUDRATE);
+    ow->brr_slot[DOW_SPEED_OVERDRIVE] = drv_usart_calculate_brr(ow->usart_no, ONE_WIRE_OD_SLOT_BAUDRATE);
+    ow->speed = DOW_SPEED_STANDARD;
+    ow->is_reset_baudrate = FALSE;
+    ow->is_inited = TRUE;
+}
+
+/**
+ * @brief Switch the port between reset and slot baudrate
+ * 
+ * @param ow The backend instance
+ * @param is_reset TRUE for reset pulse baudrate
+ */
+static void _switch_baudrate(xDrvOneWireUsart_t * ow, BOOL is_reset)
+{
+    if (is_reset != ow->is_reset_baudrate)
+    {
+        drv_usart_set_brr(ow->usart_no, is_reset ? ow->brr_reset[ow->speed] : ow->brr_slot[ow->speed]);
+        ow->is_reset_baudrate = is_reset;
+    }
+}
+
+/**
+ * @brief Set the speed of the following slots and reset pulses. Overdrive
+ *      frames have two stop bits for the slot recovery time
+ * 
+ * @param hw The backend instance
+ * @param speed The speed
+ * @return result_t RESULT_OK, both speeds are supported
+ */
+static result_t _set_speed(void * hw, eDrvOneWireSpeed_t speed)
+{
+    xDrvOneWireUsart_t * ow = (xDrvOneWireUsart_t *) hw;
+
+    if (!ow->is_inited)
+    {
+        _init(ow);
+    }
+
+    if (speed != ow->speed)
+    {
+        ow->speed = speed;
+        drv_usart_set_brr(ow->usart_no, ow->brr_slot[speed]);
+        drv_usart_set_stop_bits(ow->usart_no, (speed == DOW_SPEED_OVERDRIVE) ? DU_STOP_BITS_2 : DU_STOP_BITS_1);
+        ow->is_reset_baudrate = FALSE;
+    }
+
+    return RESULT_OK;
+}
+
+/**
+ * @brief Performs PRESENSE pulse on 1-Wire line (reset pulse)
+ * 
+ * @param hw The backend instance
+ * @return result_t RESULT_OK on presence, RESULT_NO_DEVICE without it,
+ *      RESULT_TIMEOUT or RESULT_BUS_ERROR if the line failed
+ */
+static result_t _reset(void * hw)
+{
+    xDrvOneWireUsart_t * ow = (xDrvOneWireUsart_t *) hw;
+    uint8_t read_usart_byte = ONE_WIRE_RESET_PULSE;
+    result_t res;
+
+    if (!ow->is_inited)
+    {
+        _init(ow);
+    }
+
+    _switch_baudrate(ow, TRUE);
+    res = _polled_echo(ow, ONE_WIRE_RESET_PULSE, &read_usart_byte);
+    _switch_baudrate(ow, FALSE);
+
+    if (res == RESULT_OK && read_usart_byte >= ONE_WIRE_RESET_PULSE)
+    {
+        res = RESULT_NO_DEVICE;
+    }
+
+    return res;
+}
+
+#if !ONE_WIRE_USE_DMA
+/**
+ * @brief Send the slot from interrupt driven engine. Baudrate is switched
+ *      in place when going from reset pulse to time slots and back
+ * 
+ * @param ow The backend instance
+ * @param slot The slot to send
+ */
+static void _async_send(xDrvOneWireUsart_t * ow, eDrvOneWireSlot_t slot)
+{
+    _switch_baudrate(ow, slot == DOW_SLOT_RESET);
+
+    ow->in_flight = slot;
+    drv_usart_putc(ow->usart_no, _slot_byte(slot));
+}
+
+/**
+ * @brief Finish the transaction and wake up the waiting task. Runs in
+ *      USART interrupt context
+ * 
+ * @param ow The backend instance
+ * @param result The transaction result
+ */
+static void _async_finish(xDrvOneWireUsart_t * ow, result_t result)
+{
+    BaseType_t is_higher_priority_task_woken = pdFALSE;
+
+    drv_usart_set_rx_callback(ow->usart_no, 0, 0);
+    _switch_baudrate(ow, FALSE);
+
+    ow->in_flight = DOW_SLOT_NONE;
+    ow->result = result;
+
+    vTaskNotifyGiveFromISR(ow->task, &is_higher_priority_task_woken);
+    portYIELD_FROM_ISR(is_higher_priority_task_woken);
+}
+
+/**
+ * @brief Received byte handler. Every received byte is the echo of the slot
+ *      we have sent, so it both finishes the slot and starts the next one
+ * 
+ * @param arg The backend instance
+ * @param ch Received byte
+ */
+static void _async_rx(void * arg, uint8_t ch)
+{
+    xDrvOneWireUsart_t * ow = (xDrvOneWireUsart_t *) arg;
+
+    if (ow->in_flight == DOW_SLOT_NONE)
+    {
+        return;
+    }
+
+    if (_is_framing_error(ow))
+    {
+        _async_finish(ow, RESULT_BUS_ERROR);
+        return;
+    }
+
+    result_t result = drv_one_wire_cursor_complete_slot(&ow->cursor, _sample(_slot_byte(ow->in_flight), ch));
+
+    if (result == RESULT_NOTHING)
+    {
+        eDrvOneWireSlot_t slot = drv_one_wire_cursor_next_slot(&ow->cursor);
+
+        if (slot != DOW_SLOT_NONE)
+        {
+            _async_send(ow, slot);
+            return;
+        }
+
+        result = RESULT_OK;
+    }
+
+    _async_finish(ow, result);
+}
+
+/**
+ * @brief Execute the transaction with the chained ones from the USART
+ *      interrupt. The calling task sleeps until the last slot completes or
+ *      the timeout
+ * 
+ * @param ow The backend instance
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed,
+ *      RESULT_NO_DEVICE if there was no presence pulse, RESULT_TIMEOUT if
+ *      the echo stopped, RESULT_BUS_ERROR on framing error
+ */
+static result_t _async_transaction(xDrvOneWireUsart_t * ow, xDrvOneWireTransaction_t * transaction)
+{
+    uint8_t dummy;
+
+    if (!ow->is_inited)
+    {
+        _init(ow);
+    }
+
+    drv_one_wire_cursor_init(&ow->cursor, transaction);
+
+    eDrvOneWireSlot_t slot = drv_one_wire_cursor_next_slot(&ow->cursor);
+    if (slot == DOW_SLOT_NONE)
+    {
+        return RESULT_OK;
+    }
+
+    ow->task = xTaskGetCurrentTaskHandle();
+    ow->result = RESULT_NOTHING;
+
+    // Drop the stale byte, errors and pending notification before the first slot
+    drv_usart_getc(ow->usart_no, &dummy);
+    _is_framing_error(ow);
+    ulTaskNotifyTake(pdTRUE, 0);
+    drv_usart_set_rx_callback(ow->usart_no, _async_rx, ow);
+
+    _async_send(ow, slot);
+
+    if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(drv_one_wire_get_timeout_ms(transaction))))
+    {
+        // Interrupt can't preempt us after it is disabled, so the state is ours
+        drv_usart_set_rx_callback(ow->usart_no, 0, 0);
+        ow->in_flight = DOW_SLOT_NONE;
+        _switch_baudrate(ow, FALSE);
+        DEBUG_PRINT("1-Wire: transaction timeout");
+        return RESULT_TIMEOUT;
+    }
+
+    return ow->result;
+}
+
+#else
+/**
+ * @brief Finish the transaction and wake up the waiting task. Runs in DMA
+ *      interrupt context
+ * 
+ * @param ow The backend instance
+ * @param result The transaction result
+ */
+static void _dma_finish(xDrvOneWireUsart_t * ow, result_t result)
+{
+    BaseType_t is_higher_priority_task_woken = pdFALSE;
+
+    ow->dma_count = 0;
+    ow->result = result;
+
+    vTaskNotifyGiveFromISR(ow->task, &is_higher_priority_task_woken);
+    portYIELD_FROM_ISR(is_higher_priority_task_woken);
+}
+
+static BOOL _dma_send(xDrvOneWireUsart_t * ow);
+
+/**
+ * @brief Rx DMA transfer complete callback. The echoes of the block are
+ *      decoded to the cursor and the next block of the chain is started at
+ *      once, the task is woken up only at the end. Runs in DMA interrupt
+ *      context
+ * 
+ * @param arg The backend instance
+ * @param result Transfer result
+ */
+static void _dma_rx_complete(void * arg, result_t result)
+{
+    xDrvOneWireUsart_t * ow = (xDrvOneWireUsart_t *) arg;
+
+    if (!ow->dma_count)
+    {
+        return;
+    }
+
+    if (result == RESULT_OK && _is_framing_error(ow))
+    {
+        result = RESULT_BUS_ERROR;
+    }
+
+    if (result == RESULT_OK)
+    {
+        result = drv_one_wire_usart_decode_slots(&ow->cursor, ow->dma_tx, ow->dma_rx, ow->dma_count);
+
+        if (result == RESULT_NOTHING)
+        {
+            if (_dma_send(ow))
+            {
+                return;
+            }
+
+            result = RESULT_OK;
+        }
+    }
+
+    _dma_finish(ow, result);
+}
+
+/**
+ * @brief Encode the next block of slots and start its DMA transfer: Tx DMA
+ *      sends the slot bytes, Rx DMA captures their echoes. Reset pulse is
+ *      a block of its own at reset baudrate
+ * 
+ * @param ow The backend instance
+ * @return BOOL TRUE if the block was started, FALSE if nothing left to send
+ */
+static BOOL _dma_send(xDrvOneWireUsart_t * ow)
+{
+    eDrvDmaChannel_t tx_channel, rx_channel;
+    uint16_t count = drv_one_wire_usart_encode_slots(&ow->cursor, ow->dma_tx, sizeof(ow->dma_tx));
+
+    if (!count)
+    {
+        return FALSE;
+    }
+
+    drv_usart_get_dma_channels(ow->usart_no, &tx_channel, &rx_channel);
+
+    xDrvDmaTransfer_t rx = {
+        .direction = DD_DIR_PERIPH_TO_MEM,
+        .periph_size = DD_SIZE_8,
+        .mem_size = DD_SIZE_8,
+        .priority = DD_PRIORITY_VERY_HIGH,
+        .periph_addr = drv_usart_get_dr_address(ow->usart_no),
+        .mem_addr = ow->dma_rx,
+        .count = count,
+        .mem_increment = TRUE,
+        .callback = _dma_rx_complete,
+        .callback_arg = ow
+    };
+
+    xDrvDmaTransfer_t tx = {
+        .direction = DD_DIR_MEM_TO_PERIPH,
+        .periph_size = DD_SIZE_8,
+        .mem_size = DD_SIZE_8,
+        .priority = DD_PRIORITY_HIGH,
+        .periph_addr = drv_usart_get_dr_address(ow->usart_no),
+        .mem_addr = ow->dma_tx,
+        .count = count,
+        .mem_increment = TRUE,
+        .callback = 0,
+        .callback_arg = 0
+    };
+
+    _switch_baudrate(ow, ow->dma_tx[0] == ONE_WIRE_RESET_PULSE);
+    ow->dma_count = count;
+
+    drv_dma_start(rx_channel, &rx);
+    drv_dma_start(tx_channel, &tx);
+
+    return TRUE;
+}
+
+/**
+ * @brief Execute the transaction with the chained ones with DMA. Every
+ *      block of slots is started from the completion interrupt of the
+ *      previous one, so the calling task sleeps through the whole chain
+ * 
+ * @param ow The backend instance
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed,
+ *      RESULT_NO_DEVICE if there was no presence pulse, RESULT_TIMEOUT if
+ *      DMA did not finish in time, RESULT_BUS_ERROR on framing error
+ */
+static result_t _dma_transaction(xDrvOneWireUsart_t * ow, xDrvOneWireTransaction_t * transaction)
+{
+    eDrvDmaChannel_t tx_channel, rx_channel;
+    uint8_t dummy;
+
+    if (!ow->is_inited)
+    {
+        _init(ow);
+    }
+
+    drv_one_wire_cursor_init(&ow->cursor, transaction);
+    drv_usart_get_dma_channels(ow->usart_no, &tx_channel, &rx_channel);
+
+    ow->result = RESULT_OK;
+    ow->task = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    // Drop the stale byte and errors so Rx DMA captures exactly our slots
+    drv_usart_getc(ow->usart_no, &dummy);
+    _is_framing_error(ow);
+    drv_usart_set_dma(ow->usart_no, TRUE);
+
+    if (_dma_send(ow) && !ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(drv_one_wire_get_timeout_ms(transaction))))
+    {
+        DEBUG_PRINT("1-Wire: DMA transfer timeout");
+        ow->result = RESULT_TIMEOUT;
+    }
+
+    // The callback is dropped with the channel, the state is ours
+    drv_usart_set_dma(ow->usart_no, FALSE);
+    drv_dma_stop(tx_channel);
+    drv_dma_stop(rx_channel);
+    ow->dma_count = 0;
+    _switch_baudrate(ow, FALSE);
+
+    return ow->result;
+}
+#endif
+
+/**
+ * @brief Execute the transaction. Before the scheduler starts slots are
+ *      polled, after that the calling task sleeps while the transaction is
+ *      driven by interrupts (and DMA if enabled)
+ * 
+ * @param hw The backend instance
+ * @param transaction[in/out] The transaction to execute
+ * @return result_t RESULT_OK if the transaction completed
+ */
+static result_t _transaction(void * hw, xDrvOneWireTransaction_t * transaction)
+{
+    xDrvOneWireUsart_t * ow = (xDrvOneWireUsart_t *) hw;
+
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+    {
+        return drv_one_wire_polled_transaction(&drv_one_wire_usart_ops, hw, transaction);
+    }
+
+#if ONE_WIRE_USE_DMA
+    return _dma_transaction(ow, transaction);
+#else
+    return _async_transaction(ow, transaction);
+#endif
+}
+
+#if ONE_WIRE_BENCHMARK
+/**
+ * @brief Measure with the cycle counter how long it takes to switch the bus
+ *      to reset baudrate and back by full port initialization and by BRR
+ *      switch, and print the results. The bus must be idle
+ * 
+ * @param ow The backend instance
+ */
+void drv_one_wire_usart_benchmark(xDrvOneWireUsart_t * ow)
+{
+    xDrvUsartPortParams_t usart_params = {ow->usart_no, DU_DATA_BITS_8, DU_STOP_BITS_1, DU_NO_PARITY, ONE_WIRE_RESET_BAUDRATE};
+    uint32_t init_cycles, switch_cycles, start;
+
+    if (!ow->is_inited)
+    {
+        _init(ow);
+    }
+
+    drv_dwt_init();
+
+    // Reset path of the past: full re-initialization to reset baudrate and back
+    start = drv_dwt_get_cycles();
+    drv_usart_init_port(&usart_params);
+    usart_params.baudrate = ONE_WIRE_SLOT_BAUDRATE;
+    drv_usart_init_port(&usart_params);
+    init_cycles = drv_dwt_get_cycles() - start;
+
+    start = drv_dwt_get_cycles();
+    _switch_baudrate(ow, TRUE);
+    _switch_baudrate(ow, FALSE);
+    switch_cycles = drv_dwt_get_cycles() - start;
+
+    // Every sensor read is two transactions with reset: convert and read scratch pad
+    DEBUG_PRINT("1-Wire USART%d reset baudrate switch: init %u cycles, BRR %u cycles, saved %u cycles per sensor read",
+        ow->usart_no + 1, init_cycles, switch_cycles, 2 * (init_cycles - switch_cycles));
+}
+#endif
\ No newline at end of file
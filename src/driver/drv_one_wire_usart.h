@@ -0,0 +1,93 @@
+/**
+ * @file drv_one_wire_usart.h
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief 1-wire bus backend on USART in half-duplex mode for stm32f103xx series.
+ *      Reset pulse is sent at 9600 baud, time slots at 120000 baud, at
+ *      overdrive speed at 70000 and 1000000 baud. Every
+ *      USART port is a separate bus, so buses run independently
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef _DRV_ONE_WIRE_USART_
+#define _DRV_ONE_WIRE_USART_
+
+#include "drv_one_wire.h"
+#include "drv_usart.h"
+#include "config.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define ONE_WIRE_USART_SLOT_BITS    8
+
+typedef struct
+{
+    // Configuration
+    eDrvUsartNum_t  usart_no;
+
+    // Precomputed reset and slot baudrates of every speed, switched with BRR only
+    uint32_t brr_reset[DOW_SPEED_NUM];
+    uint32_t brr_slot[DOW_SPEED_NUM];
+    eDrvOneWireSpeed_t speed;
+    BOOL is_reset_baudrate;
+
+    // Interrupt driven transaction state
+    xDrvOneWireCursor_t cursor;
+    volatile eDrvOneWireSlot_t in_flight;
+    volatile result_t result;
+    TaskHandle_t task;
+    BOOL is_inited;
+
+#if ONE_WIRE_USE_DMA
+    // DMA block transfer buffers and the slots in flight
+    uint16_t dma_count;
+    uint8_t dma_tx[ONE_WIRE_DMA_MAX_BLOCK * ONE_WIRE_USART_SLOT_BITS];
+    uint8_t dma_rx[ONE_WIRE_DMA_MAX_BLOCK * ONE_WIRE_USART_SLOT_BITS];
+#endif
+} xDrvOneWireUsart_t;
+
+#define DRV_ONE_WIRE_USART(usart)   {.usart_no = (usart)}
+
+extern const xDrvOneWireOps_t drv_one_wire_usart_ops;
+
+/**
+ * @brief Encode the next slots of the cursor into UART slot bytes, one byte
+ *      per slot: a reset pulse alone, as it needs its own baudrate, or the
+ *      time slots up to the next reset pulse
+ * 
+ * @param cursor The cursor, moved past the encoded slots
+ * @param slots[out] Slot bytes
+ * @param max The size of the slots buffer
+ * @return uint16_t The amount of slot bytes, 0 if nothing left to send
+ */
+uint16_t drv_one_wire_usart_encode_slots(xDrvOneWireCursor_t * cursor, uint8_t * slots, uint16_t max);
+
+/**
+ * @brief Store the received echoes of the encoded slots to the cursor.
+ *      Reset pulse echo shortened by the presence pulse is presence, time
+ *      slot echo pulled low by a device is read as 0
+ * 
+ * @param cursor The cursor
+ * @param slots[in] Sent slot bytes
+ * @param echoes[in] Received bytes, one per slot
+ * @param count The amount of slots
+ * @return result_t RESULT_NOTHING while more slots are expected, RESULT_OK
+ *      when the last slot completed, RESULT_NO_DEVICE if there was no presence
+ */
+result_t drv_one_wire_usart_decode_slots(xDrvOneWireCursor_t * cursor, uint8_t const * slots, uint8_t const * echoes, uint16_t count);
+
+#if ONE_WIRE_BENCHMARK
+/**
+ * @brief Measure with the cycle counter how long it takes to switch the bus
+ *      to reset baudrate and back by full port initialization and by BRR
+ *      switch, and print the results. The bus must be idle
+ * 
+ * @param ow The backend instance
+ */
+void drv_one_wire_usart_benchmark(xDrvOneWireUsart_t * ow);
+#endif
+
+#endif  //_DRV_ONE_WIRE_USART_
@@ -13,6 +13,7 @@
 #include "drv_usart.h"
 #include "stm32f103xb.h"
 #include "drv_clocks.h"
+#include "config.h"
 
 #include <math.h>
 #include <string.h>
@@ -23,6 +24,9 @@ volatile static struct xUsartContext_t
     {
         xDrvUsartPortParams_t port;
         BOOL is_hw_inited;
+        drv_usart_rx_callback_t rx_callback;
+        void * rx_callback_arg;
+        uint32_t rx_errors;                 //SR error flags of the bytes received so far
     } usart[DU_USART_NUM];
     
     
@@ -30,6 +34,7 @@ volatile static struct xUsartContext_t
 
 static result_t _calculate_usartdiv_for_baudrate(xDrvUsartPortParams_t * port_params, uint32_t * usart_div);
 static USART_TypeDef * _get_usart_registers_struct(eDrvUsartNum_t usart_no);
+static IRQn_Type _get_usart_irq_number(eDrvUsartNum_t usart_no);
 
 INLINE result_t _init_hw_usart1(void)
 {
@@ -72,6 +77,18 @@ INLINE result_t _init_hw_usart2(void)
 
 INLINE result_t _init_hw_usart3(void)
 {
+    RCC->APB1ENR |= RCC_APB1ENR_USART3EN;
+    RCC->APB2ENR |= RCC_APB2ENR_IOPBEN | RCC_APB2ENR_AFIOEN;
+
+    //TX pin
+    GPIOB->CRH &= ~(GPIO_CRH_MODE10 | GPIO_CRH_CNF10); //Clear PB10 configuration
+    GPIOB->CRH |= GPIO_CRH_MODE10_1 | GPIO_CRH_CNF10_1 | GPIO_CRH_CNF10_0; //Set PB10 to output 2MHz, alternate open-drain
+
+    //RX pin
+    GPIOB->CRH &= ~(GPIO_CRH_MODE11 | GPIO_CRH_CNF11); //Clear PB11 configuration
+    GPIOB->CRH |= GPIO_CRH_CNF11_0; //Set PB11 to floating input
+
+    AFIO->MAPR &= ~AFIO_MAPR_USART3_REMAP;
     return RESULT_OK;
 }
 
@@ -187,6 +204,26 @@ static USART_TypeDef * _get_usart_registers_struct(eDrvUsartNum_t usart_no)
     return usart;
 }
 
+/**
+ * @brief Get the interrupt number of the selected USART port
+ * 
+ * @param usart_no Port number
+ * @return IRQn_Type The interrupt number
+ */
+static IRQn_Type _get_usart_irq_number(eDrvUsartNum_t usart_no)
+{
+    IRQn_Type irq = USART1_IRQn;
+
+    switch (usart_no)
+    {
+        case DU_USART1: irq = USART1_IRQn; break;
+        case DU_USART2: irq = USART2_IRQn; break;
+        case DU_USART3: irq = USART3_IRQn; break;
+    }
+
+    return irq;
+}
+
 
 /**
  * @brief Get USART Rx line status for new bytes
@@ -244,12 +281,190 @@ result_t drv_usart_getc(eDrvUsartNum_t usart_no, uint8_t * ch)
 {
     volatile USART_TypeDef * usart = _get_usart_registers_struct(usart_no);
     result_t res = RESULT_NOTHING;
+    uint32_t sr = usart->SR;
 
-    if (drv_usart_get_rx_status(usart_no))
+    if (sr & USART_SR_RXNE)
     {
+        _cxt.usart[usart_no].rx_errors |= sr & DRV_USART_RX_ERRORS;
         *ch = usart->DR; 
         res = RESULT_OK;
     }
 
     return res;
+}
+
+/**
+ * @brief Get the address of the data register. Used as DMA peripheral address
+ * 
+ * @param usart_no The number of USART port
+ * @return volatile void* The address of USART DR register
+ */
+volatile void * drv_usart_get_dr_address(eDrvUsartNum_t usart_no)
+{
+    return &_get_usart_registers_struct(usart_no)->DR;
+}
+
+/**
+ * @brief Get DMA1 channels the USART requests are routed to
+ * 
+ * @param usart_no The number of USART port
+ * @param tx_channel[out] DMA1 channel for Tx requests
+ * @param rx_channel[out] DMA1 channel for Rx requests
+ */
+void drv_usart_get_dma_channels(eDrvUsartNum_t usart_no, eDrvDmaChannel_t * tx_channel, eDrvDmaChannel_t * rx_channel)
+{
+    switch (usart_no)
+    {
+        case DU_USART1: *tx_channel = DD_CHANNEL_4; *rx_channel = DD_CHANNEL_5; break;
+        case DU_USART2: *tx_channel = DD_CHANNEL_7; *rx_channel = DD_CHANNEL_6; break;
+        case DU_USART3: *tx_channel = DD_CHANNEL_2; *rx_channel = DD_CHANNEL_3; break;
+    }
+}
+
+/**
+ * @brief Enable or disable DMA requests of USART Rx and Tx lines
+ * 
+ * @param usart_no The number of USART port
+ * @param is_enabled TRUE to route Rx and Tx through DMA
+ */
+void drv_usart_set_dma(eDrvUsartNum_t usart_no, BOOL is_enabled)
+{
+    volatile USART_TypeDef * usart = _get_usart_registers_struct(usart_no);
+
+    if (is_enabled)
+    {
+        usart->CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
+    }
+    else
+    {
+        usart->CR3 &= ~(USART_CR3_DMAR | USART_CR3_DMAT);
+    }
+}
+
+/**
+ * @brief Calculate BRR register value for the baudrate
+ * 
+ * @param usart_no The number of USART port
+ * @param baudrate The baudrate
+ * @return uint32_t The value to write to BRR register
+ */
+uint32_t drv_usart_calculate_brr(eDrvUsartNum_t usart_no, uint32_t baudrate)
+{
+    xDrvUsartPortParams_t port_params = {usart_no, DU_DATA_BITS_8, DU_STOP_BITS_1, DU_NO_PARITY, baudrate};
+    uint32_t usart_div;
+
+    _calculate_usartdiv_for_baudrate(&port_params, &usart_div);
+
+    return usart_div;
+}
+
+/**
+ * @brief Change the baudrate of already initialized port. Only BRR and the UE
+ *      bit are touched, pins and frame settings stay as they are. Caller must
+ *      be sure there is no ongoing transfer. Safe to call from interrupt
+ * 
+ * @param usart_no The number of USART port
+ * @param brr The value calculated with drv_usart_calculate_brr()
+ */
+void drv_usart_set_brr(eDrvUsartNum_t usart_no, uint32_t brr)
+{
+    USART_TypeDef * usart = _get_usart_registers_struct(usart_no);
+
+    usart->CR1 &= ~USART_CR1_UE;
+    usart->BRR = brr;
+    usart->CR1 |= USART_CR1_UE;
+}
+
+/**
+ * @brief Change the amount of stop bits of already initialized port. Only
+ *      the STOP field of CR2 and the UE bit are touched. Caller must be sure
+ *      there is no ongoing transfer. Safe to call from interrupt
+ * 
+ * @param usart_no The number of USART port
+ * @param stop_bits The amount of stop bits
+ */
+void drv_usart_set_stop_bits(eDrvUsartNum_t usart_no, eDrvUsartStopBits_t stop_bits)
+{
+    USART_TypeDef * usart = _get_usart_registers_struct(usart_no);
+    uint32_t stop;
+
+    switch (stop_bits)
+    {
+        case DU_STOP_BITS_0_5:  stop = USART_CR2_STOP_0;                    break;
+        case DU_STOP_BITS_1_5:  stop = USART_CR2_STOP_0 | USART_CR2_STOP_1; break;
+        case DU_STOP_BITS_2:    stop = USART_CR2_STOP_1;                    break;
+        default:                stop = 0;                                   break;
+    }
+
+    usart->CR1 &= ~USART_CR1_UE;
+    usart->CR2 = (usart->CR2 & ~USART_CR2_STOP) | stop;
+    usart->CR1 |= USART_CR1_UE;
+}
+
+/**
+ * @brief Register the function to call for every received byte. The USART
+ *      interrupt is enabled while callback is registered
+ * 
+ * @param usart_no The number of USART port
+ * @param callback The function to call from interrupt, 0 to disable interrupt
+ * @param arg The argument to pass to the callback
+ */
+void drv_usart_set_rx_callback(eDrvUsartNum_t usart_no, drv_usart_rx_callback_t callback, void * arg)
+{
+    IRQn_Type irq = _get_usart_irq_number(usart_no);
+
+    NVIC_DisableIRQ(irq);
+    _cxt.usart[usart_no].rx_callback = callback;
+    _cxt.usart[usart_no].rx_callback_arg = arg;
+
+    if (callback)
+    {
+        NVIC_ClearPendingIRQ(irq);
+        NVIC_SetPriority(irq, IRQ_PRIORITY_USART);
+        NVIC_EnableIRQ(irq);
+    }
+}
+
+/**
+ * @brief Get and clear the error flags of the bytes received since the last
+ *      call. Flags still pending in SR (bytes taken by DMA) are included
+ * 
+ * @param usart_no The number of USART port
+ * @return uint32_t Mask of DRV_USART_RX_ERRORS flags, 0 if no errors
+ */
+uint32_t drv_usart_take_rx_errors(eDrvUsartNum_t usart_no)
+{
+    volatile USART_TypeDef * usart = _get_usart_registers_struct(usart_no);
+    uint32_t primask = __get_PRIMASK();
+    uint32_t errors;
+
+    // Called from tasks and from the Rx callback
+    __disable_irq();
+    errors = _cxt.usart[usart_no].rx_errors | (usart->SR & DRV_USART_RX_ERRORS);
+    _cxt.usart[usart_no].rx_errors = 0;
+    __set_PRIMASK(primask);
+
+    return errors;
+}
+
+/**
+ * @brief Common interrupt handler for USART ports
+ * 
+ * @param usart_no The port that raised the interrupt
+ */
+void drv_usart_irq_handler(eDrvUsartNum_t usart_no)
+{
+    volatile USART_TypeDef * usart = _get_usart_registers_struct(usart_no);
+    uint32_t sr = usart->SR;
+
+    if (sr & USART_SR_RXNE)
+    {
+        _cxt.usart[usart_no].rx_errors |= sr & DRV_USART_RX_ERRORS;
+        uint8_t ch = usart->DR;
+
+        if (_cxt.usart[usart_no].rx_callback)
+        {
+            _cxt.usart[usart_no].rx_callback(_cxt.usart[usart_no].rx_callback_arg, ch);
+        }
+    }
 }
\ No newline at end of file
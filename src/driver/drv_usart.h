@@ -14,6 +14,9 @@
 #include "types.h"
 #include "stm32f103xb.h"
 #include "macro.h"
+#include "drv_dma.h"
+
+#define DRV_USART_RX_ERRORS     (USART_SR_FE | USART_SR_NE | USART_SR_ORE)
 
 typedef enum
 {
@@ -55,6 +58,14 @@ typedef struct
     uint32_t            baudrate;
 } xDrvUsartPortParams_t;
 
+/**
+ * @brief Received byte callback. Called from the USART interrupt
+ * 
+ * @param arg The argument registered together with the callback
+ * @param ch Received byte
+ */
+typedef void (*drv_usart_rx_callback_t)(void * arg, uint8_t ch);
+
 /**
  * @brief Get USART Rx line status for new bytes
  * 
@@ -106,4 +117,84 @@ int32_t drv_usart_puts(eDrvUsartNum_t usart_no, uint8_t *s, uint32_t len);
  */
 result_t drv_usart_getc(eDrvUsartNum_t usart_no, uint8_t * ch);
 
+/**
+ * @brief Get the address of the data register. Used as DMA peripheral address
+ * 
+ * @param usart_no The number of USART port
+ * @return volatile void* The address of USART DR register
+ */
+volatile void * drv_usart_get_dr_address(eDrvUsartNum_t usart_no);
+
+/**
+ * @brief Get DMA1 channels the USART requests are routed to
+ * 
+ * @param usart_no The number of USART port
+ * @param tx_channel[out] DMA1 channel for Tx requests
+ * @param rx_channel[out] DMA1 channel for Rx requests
+ */
+void drv_usart_get_dma_channels(eDrvUsartNum_t usart_no, eDrvDmaChannel_t * tx_channel, eDrvDmaChannel_t * rx_channel);
+
+/**
+ * @brief Enable or disable DMA requests of USART Rx and Tx lines
+ * 
+ * @param usart_no The number of USART port
+ * @param is_enabled TRUE to route Rx and Tx through DMA
+ */
+void drv_usart_set_dma(eDrvUsartNum_t usart_no, BOOL is_enabled);
+
+/**
+ * @brief Calculate BRR register value for the baudrate
+ * 
+ * @param usart_no The number of USART port
+ * @param baudrate The baudrate
+ * @return uint32_t The value to write to BRR register
+ */
+uint32_t drv_usart_calculate_brr(eDrvUsartNum_t usart_no, uint32_t baudrate);
+
+/**
+ * @brief Change the baudrate of already initialized port. Only BRR and the UE
+ *      bit are touched, pins and frame settings stay as they are. Caller must
+ *      be sure there is no ongoing transfer. Safe to call from interrupt
+ * 
+ * @param usart_no The number of USART port
+ * @param brr The value calculated with drv_usart_calculate_brr()
+ */
+void drv_usart_set_brr(eDrvUsartNum_t usart_no, uint32_t brr);
+
+/**
+ * @brief Change the amount of stop bits of already initialized port. Only
+ *      the STOP field of CR2 and the UE bit are touched. Caller must be sure
+ *      there is no ongoing transfer. Safe to call from interrupt
+ * 
+ * @param usart_no The number of USART port
+ * @param stop_bits The amount of stop bits
+ */
+void drv_usart_set_stop_bits(eDrvUsartNum_t usart_no, eDrvUsartStopBits_t stop_bits);
+
+/**
+ * @brief Register the function to call for every received byte. The USART
+ *      interrupt is enabled while callback is registered
+ * 
+ * @param usart_no The number of USART port
+ * @param callback The function to call from interrupt, 0 to disable interrupt
+ * @param arg The argument to pass to the callback
+ */
+void drv_usart_set_rx_callback(eDrvUsartNum_t usart_no, drv_usart_rx_callback_t callback, void * arg);
+
+/**
+ * @brief Get and clear the error flags of the bytes received since the last
+ *      call. Flags still pending in SR (bytes taken by DMA) are included
+ * 
+ * @param usart_no The number of USART port
+ * @return uint32_t Mask of DRV_USART_RX_ERRORS flags, 0 if no errors
+ */
+uint32_t drv_usart_take_rx_errors(eDrvUsartNum_t usart_no);
+
+/**
+ * @brief Common interrupt handler for USART ports
+ * 
+ * @param usart_no The port that raised the interrupt
+ */
+void drv_usart_irq_handler(eDrvUsartNum_t usart_no);
+
 #endif  //_DRV_USART_
\ No newline at end of file
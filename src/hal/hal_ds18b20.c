@@ -10,44 +10,26 @@
  */
 #include "hal_ds18b20.h"
 #include "drv_one_wire.h"
+#include "drv_dwt.h"
 #include "macro.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 
-static struct 
-{
-    hal_ds18b20_cxt_t * ptr; 
-    uint32_t size;
-} _cxt;
-
-/**
- * @brief Initialisation of the sensors' context, interface and obtaining of 
- *      devices' ROM
- * 
- * @param cxt[in/out] Pointer to the context we should initialize with found devices
- * @param size[in] The size of array of the context
- * @return result_t RESULT_OK if initialization succeed
- */
-result_t hal_ds18b20_init(hal_ds18b20_cxt_t * cxt, uint32_t size)
-{
-    result_t result = RESULT_OK;
-
-    if (!cxt || !size)
-    {
-        result = RESULT_FAIL;
-    }
-    else
-    {
-        _cxt.ptr =  cxt;
-        _cxt.size = size; 
-        memset((void*)cxt, 0, sizeof(hal_ds18b20_cxt_t) * size);
-        result = hal_ds18b20_search_rom();
-    }
-
-    return result;
-}
-
-
+#define DS18B20_FAST_READ_LENGTH    2       //temp_lsb and temp_msb
+#define DS18B20_RESCAN_MISSES       2       //Rescan passes in a row that miss the sensor before it is retired
+#define DS18B20_RESCAN_EMPTY_CALLS  8       //Rescan calls in a row without presence before the pass counts as empty
+#define DS18B20_FULL_READ_PERIOD    16      //Every Nth read of the sensor is full CRC checked in fast read mode
+#define DS18B20_READ_RETRIES        2       //Full reads after a failed sweep read of a healthy sensor
+#define DS18B20_QUARANTINE_FAILURES 3       //Failed sweeps in a row before the sensor is quarantined
+#define DS18B20_QUARANTINE_MAX_SHIFT 6      //Quarantine doubles up to 64 sweeps between the probes
+#define DS18B20_MAX_JUMP            (8 << DS18B20_FRACTION_BITS)   //Bigger change between reads is verified with full read
+#define DS18B20_CONVERSION_MARGIN_MS 50     //Wait for the end of conversion longer than datasheet time
+#define DS18B20_RECHECK_MS          10      //Sleep between confirming read slots if not ready after t_CONV
+#define DS18B20_COPY_SCRATCHPAD_MS  10      //EEPROM write time, the sensor must stay powered
+#define DS18B20_CONFIGURATION_RESERVED 0x1F //Reserved bits of configuration register, read as 1
 
 static uint8_t crc_table[] = {
         0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65,
@@ -89,34 +71,497 @@ static uint8_t _calculate_crc8(uint8_t const * message, uint32_t length)
     return remainder;
 }
 
-// rom search state
-volatile static struct xSearchRomCxt_t
+/**
+ * @brief Decode the temperature from scratch pad, 1/16 C per LSB
+ * 
+ * @param scratch[in] The scratch pad
+ * @return int16_t Temperature, 1/16 C
+ */
+static int16_t _decode_temperature(hal_ds18b20_scratch_pad_t const * scratch)
+{
+    int16_t raw = (int16_t)(scratch->page_0.temp_msb << 8 | scratch->page_0.temp_lsb);
+    uint8_t resolution = (scratch->page_0.configuration_register >> DS18B20_RESOLUTION_SHIFT) & DS18B20_RESOLUTION_MASK;
+
+    // Low bits are undefined below 12 bit resolution
+    return raw & ~((1 << (DS18B20_RESOLUTION_MASK - resolution)) - 1);
+}
+
+/**
+ * @brief Check the full read of the thermometer with CRC
+ * 
+ * @param data[in] The scratch pad, the last byte is CRC
+ * @return BOOL TRUE if CRC matches
+ */
+static BOOL _is_crc_valid(uint8_t const * data)
+{
+    return _calculate_crc8(data, sizeof(hal_ds18b20_scratch_pad_t)) == 0;
+}
+
+/**
+ * @brief Decode DS18B20 and DS1822 scratch pad
+ * 
+ * @param data[in] The scratch pad
+ * @param value[out] Temperature, 1/16 C
+ * @return BOOL TRUE if the scratch pad is valid
+ */
+static BOOL _decode_ds18b20(uint8_t const * data, int16_t * value)
+{
+    if (!_is_crc_valid(data))
+    {
+        return FALSE;
+    }
+
+    *value = _decode_temperature((hal_ds18b20_scratch_pad_t const *)data);
+    return TRUE;
+}
+
+/**
+ * @brief Decode DS18S20 scratch pad. The temperature register has 0.5 C
+ *      resolution, the counters extend it: T = TEMP_READ - 0.25 +
+ *      (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C, TEMP_READ without 0.5 C bit
+ * 
+ * @param data[in] The scratch pad
+ * @param value[out] Temperature, 1/16 C
+ * @return BOOL TRUE if the scratch pad is valid
+ */
+static BOOL _decode_ds18s20(uint8_t const * data, int16_t * value)
+{
+    int16_t raw = (int16_t)(data[1] << 8 | data[0]);
+    uint8_t count_remain = data[6];
+    uint8_t count_per_c = data[7];
+
+    if (!_is_crc_valid(data) || !count_per_c)
+    {
+        return FALSE;
+    }
+
+    *value = (raw & ~1) * 8 - 4 + ((count_per_c - count_remain) << DS18B20_FRACTION_BITS) / count_per_c;
+    return TRUE;
+}
+
+/**
+ * @brief Decode DS2438 page 0: status, temperature LSB and MSB, voltage,
+ *      current and CRC. The temperature is 13 bit, 1/32 C per LSB in bits 15..3
+ * 
+ * @param data[in] The page 0
+ * @param value[out] Temperature, 1/16 C
+ * @return BOOL TRUE if the page is valid
+ */
+static BOOL _decode_ds2438(uint8_t const * data, int16_t * value)
+{
+    if (!_is_crc_valid(data))
+    {
+        return FALSE;
+    }
+
+    *value = (int16_t)(data[2] << 8 | data[1]) >> 4;
+    return TRUE;
+}
+
+/**
+ * @brief Decode DS2413 PIO Access Read byte. The upper nibble is the
+ *      complement of the lower one: PIOA pin, PIOA latch, PIOB pin, PIOB latch
+ * 
+ * @param data[in] The PIO status byte
+ * @param value[out] The lower nibble
+ * @return BOOL TRUE if the nibbles are complementary
+ */
+static BOOL _decode_ds2413(uint8_t const * data, int16_t * value)
+{
+    if ((((data[0] >> 4) ^ data[0]) & 0x0F) != 0x0F)
+    {
+        return FALSE;
+    }
+
+    *value = data[0] & 0x0F;
+    return TRUE;
+}
+
+/**
+ * @brief Get the conversion time of DS18S20, it has no resolution setting
+ * 
+ * @param configuration[in] Not used
+ * @return uint16_t Conversion time, ms
+ */
+static uint16_t _get_ds18s20_conversion_time(uint8_t configuration)
+{
+    return 750;
+}
+
+/**
+ * @brief Get the temperature conversion time of DS2438
+ * 
+ * @param configuration[in] Not used
+ * @return uint16_t Conversion time, ms
+ */
+static uint16_t _get_ds2438_conversion_time(uint8_t configuration)
+{
+    return 10;
+}
+
+// Drivers of the device families found on the bus. The sweep reads the
+// devices of one family together, with the family's read command and decode
+static const hal_ds18b20_family_t _families[] = {
+    {
+        .family = FAMILY_DS18B20,
+        .read_command = {CMD_READ_SCRATCHPAD}, .read_command_length = 1,
+        .read_length = sizeof(hal_ds18b20_scratch_pad_t),
+        .is_thermometer = TRUE, .is_configurable = TRUE, .has_alarm = TRUE,
+        .get_conversion_time = hal_ds18b20_get_conversion_time,
+        .decode = _decode_ds18b20
+    },
+    {
+        .family = FAMILY_DS1822,
+        .read_command = {CMD_READ_SCRATCHPAD}, .read_command_length = 1,
+        .read_length = sizeof(hal_ds18b20_scratch_pad_t),
+        .is_thermometer = TRUE, .is_configurable = TRUE, .has_alarm = TRUE,
+        .get_conversion_time = hal_ds18b20_get_conversion_time,
+        .decode = _decode_ds18b20
+    },
+    {
+        .family = FAMILY_DS18S20,
+        .read_command = {CMD_READ_SCRATCHPAD}, .read_command_length = 1,
+        .read_length = sizeof(hal_ds18b20_scratch_pad_t),
+        .is_thermometer = TRUE, .has_alarm = TRUE,
+        .get_conversion_time = _get_ds18s20_conversion_time,
+        .decode = _decode_ds18s20
+    },
+    {
+        .family = FAMILY_DS2438,
+        .recall_command = {CMD_RECALL_E2, 0}, .recall_command_length = 2,
+        .read_command = {CMD_READ_SCRATCHPAD, 0}, .read_command_length = 2,
+        .read_length = sizeof(hal_ds18b20_scratch_pad_t),
+        .is_thermometer = TRUE,
+        .get_conversion_time = _get_ds2438_conversion_time,
+        .decode = _decode_ds2438
+    },
+    {
+        .family = FAMILY_DS2413,
+        .read_command = {CMD_PIO_ACCESS_READ}, .read_command_length = 1,
+        .read_length = 1,
+        .decode = _decode_ds2413
+    }
+};
+
+/**
+ * @brief Find the driver of the device family
+ * 
+ * @param family[in] ROM family code
+ * @return uint8_t The driver index, DS18B20_NO_DRIVER if the family is not supported
+ */
+static uint8_t _find_driver(uint8_t family)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(_families); i++)
+    {
+        if (_families[i].family == family)
+        {
+            return i;
+        }
+    }
+
+    return DS18B20_NO_DRIVER;
+}
+
+/**
+ * @brief Get the driver by its index
+ * 
+ * @param driver[in] The driver index from _find_driver()
+ * @return hal_ds18b20_family_t const* The driver, 0 for DS18B20_NO_DRIVER
+ */
+static hal_ds18b20_family_t const * _get_family(uint8_t driver)
+{
+    return driver == DS18B20_NO_DRIVER ? 0 : &_families[driver];
+}
+
+/**
+ * @brief Copy the device's memory to its scratch pad if the family must
+ *      recall it before the read, like DS2438 page 0
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param family[in] The device's driver
+ * @param rom[in] The device's ROM
+ * @return result_t RESULT_OK if there is nothing to recall or it is done
+ */
+static result_t _recall(hal_ds18b20_t * hal, hal_ds18b20_family_t const * family, hal_ds18b20_rom_t const * rom)
+{
+    if (!family->recall_command_length)
+    {
+        return RESULT_OK;
+    }
+
+    xDrvOneWireTransaction_t recall = {
+        .is_reset = TRUE,
+        .rom_command = CMD_MATCH_ROM,
+        .rom = rom->b,
+        .tx = family->recall_command,
+        .tx_length = family->recall_command_length
+    };
+
+    return drv_one_wire_transaction(hal->bus, &recall);
+}
+
+/**
+ * @brief Read the device with the full read of its family and decode it
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param family[in] The device's driver
+ * @param rom[in] The device's ROM
+ * @param value[out] The decoded value
+ * @return result_t RESULT_OK if the read is valid
+ */
+static result_t _read_full(hal_ds18b20_t * hal, hal_ds18b20_family_t const * family, hal_ds18b20_rom_t const * rom, int16_t * value)
+{
+    hal_ds18b20_scratch_pad_t scratch;
+    result_t result = _recall(hal, family, rom);
+
+    if (result == RESULT_OK)
+    {
+        xDrvOneWireTransaction_t read = {
+            .is_reset = TRUE,
+            .rom_command = CMD_MATCH_ROM,
+            .rom = rom->b,
+            .tx = family->read_command,
+            .tx_length = family->read_command_length,
+            .rx = (uint8_t *)&scratch,
+            .rx_length = family->read_length
+        };
+
+        result = drv_one_wire_transaction(hal->bus, &read);
+    }
+
+    if (result == RESULT_OK && !family->decode((uint8_t const *)&scratch, value))
+    {
+        result = RESULT_FAIL;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Read the settings of the sensor just found by the search
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param i[in] The sensor's index, its ROM is filled in
+ */
+static void _setup_sensor(hal_ds18b20_t * hal, uint32_t i)
+{
+    hal_ds18b20_table_t * sensors = &hal->sensors;
+    hal_ds18b20_scratch_pad_t scratch;
+
+    sensors->driver[i] = _find_driver(sensors->rom[i].family);
+    sensors->configuration[i] = DS18B20_CONFIGURATION_12BIT;
+    sensors->value[i] = DS18B20_TEMPERATURE_INVALID;
+    sensors->fast_reads[i] = 0;
+    sensors->is_alarm[i] = FALSE;
+    sensors->seen_pass[i] = hal->rescan.pass;
+    sensors->failures[i] = 0;
+    sensors->errors[i] = 0;
+    sensors->quarantine[i] = 0;
+    sensors->backoff[i] = 0;
+    sensors->period[i] = 1;
+    sensors->wait[i] = 0;
+    sensors->timestamp[i] = 0;
+
+    hal_ds18b20_family_t const * family = _get_family(sensors->driver[i]);
+    if (!family)
+    {
+        DEBUG_PRINT("No driver for family 0x%02x", sensors->rom[i].family);
+    }
+    else if (family->is_configurable && hal_ds18b20_read_scratch(hal, &sensors->rom[i], &scratch, 0) == RESULT_OK)
+    {
+        sensors->configuration[i] = scratch.page_0.configuration_register;
+    }
+}
+
+/**
+ * @brief Calculate CRC-16 of 1-Wire devices, polynomial x^16 + x^15 + x^2 + 1
+ * 
+ * @param message[in] Pointer to the data to check
+ * @param length[in] Data length
+ * @return uint16_t The calculated value
+ */
+static uint16_t _calculate_crc16(uint8_t const * message, uint32_t length)
+{
+    uint16_t crc = 0;
+
+    while (length--)
+    {
+        crc ^= *message++;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Take the sensors from the cache if every cached sensor answers.
+ *      Sensors with the configuration register are checked with the scratch
+ *      pad read up to it, its bit 7 reads 0 only if the sensor drives the
+ *      line. Other families are checked with their full read. Devices
+ *      without driver can not be checked, they make the search run
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param cache[in] ROMs saved by the previous run
+ * @return result_t RESULT_OK if the table is filled from the cache
+ */
+static result_t _restore_rom(hal_ds18b20_t * hal, hal_ds18b20_rom_cache_t const * cache)
+{
+    if (cache->magic != DS18B20_ROM_CACHE_MAGIC || !cache->count ||
+        cache->count > DS18B20_MAX_SENSORS ||
+        cache->crc != _calculate_crc16((uint8_t const *)cache, offsetof(hal_ds18b20_rom_cache_t, crc)))
+    {
+        DEBUG_PRINT("ROM cache is not valid");
+        return RESULT_FAIL;
+    }
+
+    for (uint32_t i = 0; i < cache->count; i++)
+    {
+        hal_ds18b20_rom_t * rom = &hal->sensors.rom[i];
+        hal_ds18b20_scratch_pad_t scratch = {.page_0.configuration_register = 0};
+        result_t result = RESULT_NO_DEVICE;
+
+        rom->qw = cache->rom[i];
+        hal->sensors.driver[i] = _find_driver(rom->family);
+        hal_ds18b20_family_t const * family = _get_family(hal->sensors.driver[i]);
+
+        if (family && family->is_configurable)
+        {
+            xDrvOneWireTransaction_t transaction = {
+                .is_reset = TRUE,
+                .rom_command = CMD_MATCH_ROM,
+                .rom = rom->b,
+                .command = CMD_READ_SCRATCHPAD,
+                .rx = (uint8_t *)&scratch,
+                .rx_length = offsetof(hal_ds18b20_scratch_pad_t, page_0.configuration_register) + 1
+            };
+
+            result = drv_one_wire_transaction(hal->bus, &transaction);
+            if (result == RESULT_OK && (scratch.page_0.configuration_register & ~DS18B20_CONFIGURATION_12BIT))
+            {
+                result = RESULT_NO_DEVICE;
+            }
+        }
+        else if (family)
+        {
+            int16_t value;
+
+            result = _read_full(hal, family, rom, &value);
+        }
+
+        if (result != RESULT_OK)
+        {
+            DEBUG_PRINT("Cached sensor is gone: 0x%08x%08x", UPPER32(cache->rom[i]), LOWER32(cache->rom[i]));
+            hal->sensors.count = 0;
+            return result;
+        }
+
+        hal->sensors.configuration[i] = scratch.page_0.configuration_register;
+        hal->sensors.value[i] = DS18B20_TEMPERATURE_INVALID;
+        hal->sensors.count = i + 1;
+    }
+
+    return RESULT_OK;
+}
+
+/**
+ * @brief Make the cache of the sensors' ROMs to save in non-volatile memory
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param cache[out] The cache. Unused bytes are zeroed, so equal tables give
+ *      equal caches
+ */
+void hal_ds18b20_fill_rom_cache(hal_ds18b20_t const * hal, hal_ds18b20_rom_cache_t * cache)
+{
+    memset(cache, 0, sizeof(hal_ds18b20_rom_cache_t));
+    cache->magic = DS18B20_ROM_CACHE_MAGIC;
+
+    cache->count = hal->sensors.count;
+    memcpy(cache->rom, hal->sensors.rom, sizeof(uint64_t) * cache->count);
+
+    cache->crc = _calculate_crc16((uint8_t const *)cache, offsetof(hal_ds18b20_rom_cache_t, crc));
+}
+
+/**
+ * @brief Initialisation of the sensors' context, interface and obtaining of 
+ *      devices' ROM. Cached ROMs are checked with one short read per sensor,
+ *      the full search runs only if the cache is broken or a sensor is gone
+ * 
+ * @param hal[out] The instance to initialize, the found sensors are in
+ *      hal->sensors
+ * @param bus[in] The 1-Wire bus the sensors are connected to
+ * @param cache[in] ROMs saved by the previous run, 0 to search
+ * @return result_t RESULT_OK if initialization succeed
+ */
+result_t hal_ds18b20_init(hal_ds18b20_t * hal, xDrvOneWireBus_t * bus, hal_ds18b20_rom_cache_t const * cache)
 {
-    uint32_t last_discrepancy;
-    uint32_t last_family_discrepancy;
-    BOOL is_last_device;
-    uint8_t crc8;
-} _search_rom_cxt = {0};
+    result_t result = RESULT_OK;
+
+    if (!hal || !bus)
+    {
+        result = RESULT_FAIL;
+    }
+    else
+    {
+        memset(hal, 0, sizeof(hal_ds18b20_t));
+        hal->bus = bus;
+
+        if (cache && _restore_rom(hal, cache) == RESULT_OK)
+        {
+            DEBUG_PRINT("ROM cache restored");
+        }
+        else
+        {
+            result = hal_ds18b20_search_rom(hal);
+
+            for (uint32_t i = 0; result == RESULT_OK && i < hal->sensors.count; i++)
+            {
+                _setup_sensor(hal, i);
+            }
+        }
+    }
+
+    if (result == RESULT_OK)
+    {
+        hal_ds18b20_rom_t broadcast = {.qw = DS18B20_BROADCAST_ROM};
+
+        hal_ds18b20_read_power_supply(hal, &broadcast, &hal->is_parasite);
+        DEBUG_PRINT("DS18B20 parasite power: %d", hal->is_parasite);
+    }
+
+    return result;
+}
+
 
 /**
  * @brief Reset ROM search context
  * 
+ * @param search[out] The search state
  */
-static void _reset_search_rom_cxt(void)
+static void _reset_search_rom_cxt(hal_ds18b20_search_t * search)
 {
-    _search_rom_cxt.last_discrepancy = 0;
-    _search_rom_cxt.is_last_device = FALSE;
-    _search_rom_cxt.last_family_discrepancy = 0;
-    _search_rom_cxt.crc8 = 0;
+    search->last_discrepancy = 0;
+    search->is_last_device = FALSE;
+    search->last_family_discrepancy = 0;
+    search->crc8 = 0;
 }
 
 /**
  * @brief Search ROM of one device
  * 
- * @param rom[out] The pointer to the ROM storage
- * @return result_t RESULT_OK if we found one more ROM
+ * @param hal[in] The sensors bus instance
+ * @param search[in/out] The search state, hal->search unless the search
+ *      is resumed later
+ * @param command[in] CMD_SEARCH_ROM for all devices, CMD_ALARM_SEARCH for
+ *      the devices with alarm flag set
+ * @param rom[in/out] The ROM found by the previous call, replaced with the
+ *      next one. The search follows it below the last discrepancy
+ * @return result_t RESULT_SUCCESS if we found one more ROM, the reset result
+ *      if the bus failed to reset
  */
-static result_t _search_one_rom( volatile uint64_t * rom)
+static result_t _search_one_rom(hal_ds18b20_t * hal, hal_ds18b20_search_t * search, uint8_t command, volatile uint64_t * rom)
 {
    volatile uint8_t id_bit_number = 0;
    volatile uint8_t last_zero = 0;
@@ -125,26 +570,28 @@ static result_t _search_one_rom( volatile uint64_t * rom)
    volatile uint8_t search_direction;
 
     // 1-Wire reset
-    if (drv_one_wire_reset() != RESULT_OK)
+    search_result = drv_one_wire_reset(hal->bus);
+    if (search_result != RESULT_OK)
     {
-        _reset_search_rom_cxt();
+        _reset_search_rom_cxt(search);
         DEBUG_PRINT("Search ROM reset failed");
-        return RESULT_FAIL;
+        return search_result;
     }
+    search_result = RESULT_FAIL;
 
     // if the last call was not the last one
-   if (!_search_rom_cxt.is_last_device)
+   if (!search->is_last_device)
    {
 
         // issue the search command 
-        drv_one_wire_write_byte(CMD_SEARCH_ROM); 
+        drv_one_wire_write_byte(hal->bus, command); 
 
         // loop to do the search
         do
         {
             // read a bit and its complement
-            id_bit = drv_one_wire_read_bit();
-            cmp_id_bit = drv_one_wire_read_bit();
+            id_bit = drv_one_wire_read_bit(hal->bus);
+            cmp_id_bit = drv_one_wire_read_bit(hal->bus);
 
             // check for no devices on 1-wire
             if ((id_bit == 1) && (cmp_id_bit == 1))
@@ -158,13 +605,13 @@ static result_t _search_one_rom( volatile uint64_t * rom)
                 // all devices coupled have 0 or 1
                 if (id_bit == 0 && cmp_id_bit == 0)
                 {
-                    if (id_bit_number == _search_rom_cxt.last_discrepancy)
+                    if (id_bit_number == search->last_discrepancy)
                     {
                         search_direction = 1;
                     }
                     else
                     {
-                        if (id_bit_number > _search_rom_cxt.last_discrepancy)
+                        if (id_bit_number > search->last_discrepancy)
                         {
                             search_direction = 0;
                         }
@@ -184,7 +631,7 @@ static result_t _search_one_rom( volatile uint64_t * rom)
                         // check for Last discrepancy in family
                         if (last_zero < 9)
                         {
-                            _search_rom_cxt.last_family_discrepancy = last_zero;
+                            search->last_family_discrepancy = last_zero;
                         }
                     }
                 }
@@ -209,7 +656,7 @@ static result_t _search_one_rom( volatile uint64_t * rom)
                 //DEBUG_PRINT("write search dir: %d", search_direction);
 
                 // serial number search direction write bit
-                drv_one_wire_write_bit(search_direction);
+                drv_one_wire_write_bit(hal->bus, search_direction);
 
                 // increment the byte counter id_bit_number
                 id_bit_number++;
@@ -217,21 +664,17 @@ static result_t _search_one_rom( volatile uint64_t * rom)
         } while(id_bit_number < 64);  // loop until through all ROM bytes 0-7
 
         // search successful so set last_discrepancy,is_last_device,search_result
-        _search_rom_cxt.last_discrepancy = last_zero;
+        search->last_discrepancy = last_zero;
 
         // check for last device
-        if (_search_rom_cxt.last_discrepancy == 0)
+        if (search->last_discrepancy == 0)
         {
-            _search_rom_cxt.is_last_device = TRUE;
+            search->is_last_device = TRUE;
         }
       
-        if (id_bit_number == 64)
-        {
-            search_result = RESULT_SUCCESS;
-        }
-
-        // if the search was successful then
-        if (_calculate_crc8((uint8_t *) rom, sizeof(uint64_t)) == 0)
+        // all 64 bits were read and the ROM is consistent. An empty alarm
+        // search stops at the first bit and keeps the previous ROM
+        if (id_bit_number == 64 && _calculate_crc8((uint8_t *) rom, sizeof(uint64_t)) == 0)
         {
             search_result = RESULT_SUCCESS;
         }
@@ -240,7 +683,7 @@ static result_t _search_one_rom( volatile uint64_t * rom)
     // if no device found then reset counters so next 'search' will be like a first
     if (search_result != RESULT_SUCCESS || !*rom)
     {
-        _reset_search_rom_cxt();
+        _reset_search_rom_cxt(search);
     }
 
    return search_result;
@@ -249,85 +692,276 @@ static result_t _search_one_rom( volatile uint64_t * rom)
 /**
  * @brief This function obtains ROM code of all devices on the 1-Wire line
  * 
+ * @param hal[in] The sensors bus instance
  * @return result_t RESULT_OK if we found all devices without troubles
  */
-result_t hal_ds18b20_search_rom(void)
+result_t hal_ds18b20_search_rom(hal_ds18b20_t * hal)
 {
-    uint8_t i = 0;
-    while (_search_one_rom(&_cxt.ptr[i].rom.qw) == RESULT_SUCCESS && i < _cxt.size)
+    uint64_t rom = 0;
+    uint32_t i = 0;
+
+    _reset_search_rom_cxt(&hal->search);
+    while (i < DS18B20_MAX_SENSORS && _search_one_rom(hal, &hal->search, CMD_SEARCH_ROM, &rom) == RESULT_SUCCESS && rom)
     {
-        DEBUG_PRINT("Found: 0x%08x%08x", UPPER32(_cxt.ptr[i].rom.qw), LOWER32(_cxt.ptr[i].rom.qw));
+        hal->sensors.rom[i].qw = rom;
+        DEBUG_PRINT("Found: 0x%08x%08x", UPPER32(rom), LOWER32(rom));
         i++;
     }
+    hal->sensors.count = i;
     return RESULT_OK;
 }
 
 /**
- * @brief We can read ROM in case if we have only one device on the line
+ * @brief Find the sensor in the table
  * 
- * @param rom[out] Sensor's ROM 
- * @return result_t RESULT_OK if we succeed to get ROM
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM
+ * @param index[out] The sensor's index
+ * @return BOOL TRUE if the sensor is known
  */
-result_t hal_ds18b20_read_rom(hal_ds18b20_rom_t * rom) 
+static BOOL _find_sensor(hal_ds18b20_t * hal, uint64_t rom, uint32_t * index)
 {
-    drv_one_wire_reset();
-    drv_one_wire_write_byte(CMD_READ_ROM);
-    drv_one_wire_read_data((uint8_t *) rom, sizeof(uint64_t));
-    return RESULT_OK;
+    for (uint32_t i = 0; i < hal->sensors.count; i++)
+    {
+        if (hal->sensors.rom[i].qw == rom)
+        {
+            *index = i;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
 }
 
 /**
- * @brief Before we send any command to the sensor we should choose it
- *      by this command
+ * @brief Add the sensor found by the rescan to the end of the table
  * 
- * @param rom[in] Sensor's ROM
- * @return result_t RESULT_OK if the command was sent successfully
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM
  */
-result_t hal_ds18b20_match_rom(hal_ds18b20_rom_t * rom) 
+static void _add_sensor(hal_ds18b20_t * hal, uint64_t rom)
 {
-    drv_one_wire_reset();
-    drv_one_wire_write_byte(CMD_MATCH_ROM);
-    drv_one_wire_write_data((uint8_t *) rom, sizeof(uint64_t));
-    return RESULT_OK;
+    uint32_t i = hal->sensors.count;
+    BOOL is_parasite = FALSE;
+
+    if (i == DS18B20_MAX_SENSORS)
+    {
+        DEBUG_PRINT("No room for: 0x%08x%08x", UPPER32(rom), LOWER32(rom));
+        return;
+    }
+
+    hal->sensors.rom[i].qw = rom;
+    _setup_sensor(hal, i);
+    hal->sensors.count++;
+
+    if (hal_ds18b20_read_power_supply(hal, &hal->sensors.rom[i], &is_parasite) == RESULT_OK && is_parasite)
+    {
+        hal->is_parasite = TRUE;
+    }
+    DEBUG_PRINT("Added: 0x%08x%08x", UPPER32(rom), LOWER32(rom));
 }
 
 /**
- * @brief Skip ROM command allows to send broadcast commands or to save time
- *      for the command in case  we have only one device on the line
+ * @brief Move the sensor to another place of the table
  * 
- * @return result_t RESULT_OK if the command was sent successfully
+ * @param sensors[in/out] The sensors table
+ * @param to[in] The new index
+ * @param from[in] The old index
+ */
+static void _move_sensor(hal_ds18b20_table_t * sensors, uint32_t to, uint32_t from)
+{
+    sensors->rom[to] = sensors->rom[from];
+    sensors->value[to] = sensors->value[from];
+    sensors->driver[to] = sensors->driver[from];
+    sensors->configuration[to] = sensors->configuration[from];
+    sensors->fast_reads[to] = sensors->fast_reads[from];
+    sensors->is_alarm[to] = sensors->is_alarm[from];
+    sensors->seen_pass[to] = sensors->seen_pass[from];
+    sensors->failures[to] = sensors->failures[from];
+    sensors->errors[to] = sensors->errors[from];
+    sensors->quarantine[to] = sensors->quarantine[from];
+    sensors->backoff[to] = sensors->backoff[from];
+    sensors->period[to] = sensors->period[from];
+    sensors->wait[to] = sensors->wait[from];
+    sensors->timestamp[to] = sensors->timestamp[from];
+}
+
+/**
+ * @brief Remove the sensors missed by the last DS18B20_RESCAN_MISSES passes
+ *      and close the gaps
+ * 
+ * @param hal[in] The sensors bus instance
+ */
+static void _retire_missing(hal_ds18b20_t * hal)
+{
+    hal_ds18b20_table_t * sensors = &hal->sensors;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < sensors->count; i++)
+    {
+        if ((uint8_t)(hal->rescan.pass - sensors->seen_pass[i]) >= DS18B20_RESCAN_MISSES)
+        {
+            DEBUG_PRINT("Retired: 0x%08x%08x", UPPER32(sensors->rom[i].qw), LOWER32(sensors->rom[i].qw));
+            continue;
+        }
+
+        if (count != i)
+        {
+            _move_sensor(sensors, count, i);
+        }
+        count++;
+    }
+
+    sensors->count = count;
+}
+
+/**
+ * @brief Walk a few branches of the ROM search tree. Sensors found that are
+ *      not in the table are added, sensors that are not found by
+ *      DS18B20_RESCAN_MISSES complete passes in a row are retired. Call it
+ *      between sweeps to follow the probes plugged and unplugged at run time.
+ *      Missing presence breaks the pass like any bus error, only
+ *      DS18B20_RESCAN_EMPTY_CALLS calls in a row without it make an empty pass
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param steps[in] The maximum amount of ROMs to search, one search takes
+ *      about as long as reading two scratch pads
+ * @return result_t RESULT_OK if the steps completed, the bus error otherwise.
+ *      The pass restarts on the next call after an error
  */
-result_t hal_ds18b20_skip_rom(void) 
+result_t hal_ds18b20_rescan(hal_ds18b20_t * hal, uint32_t steps)
 {
-    drv_one_wire_reset();
-    drv_one_wire_write_byte(CMD_SKIP_ROM);
+    while (steps--)
+    {
+        result_t result = _search_one_rom(hal, &hal->rescan.search, CMD_SEARCH_ROM, &hal->rescan.rom);
+
+        if (result == RESULT_SUCCESS && hal->rescan.rom)
+        {
+            uint32_t i;
+
+            hal->rescan.empty_calls = 0;
+
+            if (_find_sensor(hal, hal->rescan.rom, &i))
+            {
+                hal->sensors.seen_pass[i] = hal->rescan.pass;
+            }
+            else
+            {
+                _add_sensor(hal, hal->rescan.rom);
+            }
+
+            if (!hal->rescan.search.is_last_device)
+            {
+                continue;
+            }
+        }
+        else if (result != RESULT_NO_DEVICE || ++hal->rescan.empty_calls < DS18B20_RESCAN_EMPTY_CALLS)
+        {
+            // The pass is broken, nothing is retired by it. A lost presence
+            // pulse is as likely a glitch as an empty bus
+            _reset_search_rom_cxt(&hal->rescan.search);
+            hal->rescan.rom = 0;
+            return result == RESULT_SUCCESS ? RESULT_FAIL : result;
+        }
+        else
+        {
+            hal->rescan.empty_calls = 0;
+        }
+
+        // The pass is complete, every sensor on the bus was found
+        _retire_missing(hal);
+        _reset_search_rom_cxt(&hal->rescan.search);
+        hal->rescan.rom = 0;
+        hal->rescan.pass++;
+    }
+
     return RESULT_OK;
 }
 
+/**
+ * @brief We can read ROM in case if we have only one device on the line
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[out] Sensor's ROM 
+ * @return result_t RESULT_OK if we succeed to get ROM
+ */
+result_t hal_ds18b20_read_rom(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom) 
+{
+    drv_one_wire_reset(hal->bus);
+    drv_one_wire_write_byte(hal->bus, CMD_READ_ROM);
+    drv_one_wire_read_data(hal->bus, (uint8_t *) rom, sizeof(uint64_t));
+    return RESULT_OK;
+}
 
-void hal_ds18b20_recall_memory(uint8_t page) 
+/**
+ * @brief Before we send any command to the sensor we should choose it
+ *      by this command
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] Sensor's ROM
+ * @return result_t RESULT_OK if the command was sent successfully
+ */
+result_t hal_ds18b20_match_rom(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom) 
 {
-    hal_ds18b20_skip_rom();
-    drv_one_wire_write_byte(CMD_RECALL_E2);
-    drv_one_wire_write_byte(page);
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = CMD_MATCH_ROM,
+        .rom = rom->b,
+        .command = ONE_WIRE_NO_COMMAND
+    };
+
+    return drv_one_wire_transaction(hal->bus, &transaction);
+}
+
+/**
+ * @brief Skip ROM command allows to send broadcast commands or to save time
+ *      for the command in case  we have only one device on the line
+ * 
+ * @param hal[in] The sensors bus instance
+ * @return result_t RESULT_OK if the command was sent successfully
+ */
+result_t hal_ds18b20_skip_rom(hal_ds18b20_t * hal) 
+{
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = CMD_SKIP_ROM,
+        .command = ONE_WIRE_NO_COMMAND
+    };
+
+    return drv_one_wire_transaction(hal->bus, &transaction);
+}
+
+
+void hal_ds18b20_recall_memory(hal_ds18b20_t * hal, uint8_t page) 
+{
+    hal_ds18b20_skip_rom(hal);
+    drv_one_wire_write_byte(hal->bus, CMD_RECALL_E2);
+    drv_one_wire_write_byte(hal->bus, page);
 }
 
 /**
  * @brief Reads scratch pad of the sensor
  * 
+ * @param hal[in] The sensors bus instance
  * @param rom[in] The device's ROM
  * @param scratch[out] The struct where to store scratch pad values
  * @param page[in] The number of scratch pad page 
  * @return result_t RESULT_OK if we read out successfully
  */
-result_t hal_ds18b20_read_scratch(hal_ds18b20_rom_t * rom, hal_ds18b20_scratch_pad_t * scratch, uint8_t page)
+result_t hal_ds18b20_read_scratch(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, hal_ds18b20_scratch_pad_t * scratch, uint8_t page)
 {
-    result_t res = RESULT_OK;
-    hal_ds18b20_match_rom(rom);
-    drv_one_wire_write_byte(CMD_READ_SCRATCHPAD);
-    drv_one_wire_read_data((uint8_t *)(&(scratch->page_0) + page), 9);
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = CMD_MATCH_ROM,
+        .rom = rom->b,
+        .command = CMD_READ_SCRATCHPAD,
+        .rx = (uint8_t *)(&(scratch->page_0) + page),
+        .rx_length = 9
+    };
+
+    result_t res = drv_one_wire_transaction(hal->bus, &transaction);
     
-    if (_calculate_crc8((uint8_t *)(&(scratch->page_0) + page),9) != 0) 
+    if (res == RESULT_OK && _calculate_crc8((uint8_t *)(&(scratch->page_0) + page),9) != 0) 
     {
         res = RESULT_FAIL;
     }
@@ -336,88 +970,1056 @@ result_t hal_ds18b20_read_scratch(hal_ds18b20_rom_t * rom, hal_ds18b20_scratch_p
 }
 
 /**
- * @brief Convert temperature function sends the command and waits till conversion ends
+ * @brief Check whether the sensors are parasite powered with Read Power Supply
  * 
- * @param rom[in] The device we should start conversion
- * @return result_t RESULT_OK if conversion finished successfully
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor to check, DS18B20_BROADCAST_ROM to check all sensors
+ * @param is_parasite[out] TRUE if the sensor (any sensor for broadcast) is parasite powered
+ * @return result_t RESULT_OK if the command was sent successfully
  */
-result_t hal_ds18b20_convert_temperature(hal_ds18b20_rom_t * rom) 
+result_t hal_ds18b20_read_power_supply(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, BOOL * is_parasite)
 {
-    result_t result;
-    if (rom->qw == DS18B20_BROADCAST_ROM)
+    BOOL is_broadcast = (rom->qw == DS18B20_BROADCAST_ROM);
+    uint8_t status = 0xFF;
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = is_broadcast ? CMD_SKIP_ROM : CMD_MATCH_ROM,
+        .rom = is_broadcast ? 0 : rom->b,
+        .command = CMD_READ_POWER_SUPPLY,
+        .rx = &status,
+        .rx_length = 1
+    };
+
+    result_t result = drv_one_wire_transaction(hal->bus, &transaction);
+
+    // Parasite powered sensors pull the read slot low
+    *is_parasite = (result == RESULT_OK) && !(status & 0x01);
+
+    return result;
+}
+
+/**
+ * @brief Write TH, TL and configuration with Write Scratchpad, check them
+ *      with Read Scratchpad and optionally copy them to EEPROM
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM
+ * @param th[in] TH register value
+ * @param tl[in] TL register value
+ * @param configuration[in] Configuration register value, not written to
+ *      the families without it
+ * @param is_persistent[in] TRUE to copy the scratch pad to EEPROM
+ * @return result_t RESULT_OK if the sensor reads back the written values
+ */
+static result_t _write_scratch(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, uint8_t th, uint8_t tl, uint8_t configuration, BOOL is_persistent)
+{
+    hal_ds18b20_family_t const * family = _get_family(_find_driver(rom->family));
+    hal_ds18b20_scratch_pad_t scratch;
+    uint8_t data[] = {th, tl, configuration};
+
+    if (!family || !family->has_alarm)
     {
-        result = hal_ds18b20_skip_rom();
+        return RESULT_FAIL;
     }
-    else
+
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = CMD_MATCH_ROM,
+        .rom = rom->b,
+        .command = CMD_WRITE_SCRATCHPAD,
+        .tx = data,
+        .tx_length = family->is_configurable ? sizeof(data) : sizeof(data) - 1
+    };
+
+    result_t result = drv_one_wire_transaction(hal->bus, &transaction);
+
+    if (result == RESULT_OK)
     {
-        result = hal_ds18b20_match_rom(rom);
+        result = hal_ds18b20_read_scratch(hal, rom, &scratch, 0);
+    }
+
+    if (result == RESULT_OK && (scratch.page_0.th_register != th || scratch.page_0.tl_register != tl ||
+        (family->is_configurable && scratch.page_0.configuration_register != configuration)))
+    {
+        result = RESULT_FAIL;
+    }
+
+    if (result == RESULT_OK && is_persistent)
+    {
+        xDrvOneWireTransaction_t copy = {
+            .is_reset = TRUE,
+            .rom_command = CMD_MATCH_ROM,
+            .rom = rom->b,
+            .command = CMD_COPY_SCRATCHPAD
+        };
+        uint8_t header[ONE_WIRE_HEADER_MAX];
+
+        // Parasite sensors take the EEPROM write current from the strong pull-up
+        xDrvOneWireStep_t steps[] = {
+            {.type = DOW_STEP_RESET},
+            {.type = DOW_STEP_WRITE, .tx = header, .length = drv_one_wire_build_header(&copy, header)},
+            {.type = DOW_STEP_PULLUP, .time_ms = DS18B20_COPY_SCRATCHPAD_MS}
+        };
+
+        result = drv_one_wire_script(hal->bus, steps, ARRAY_SIZE(steps));
+    }
+
+    if (result == RESULT_OK)
+    {
+        uint32_t i;
+
+        if (family->is_configurable && _find_sensor(hal, rom->qw, &i))
+        {
+            hal->sensors.configuration[i] = configuration;
+        }
     }
-    
-    drv_one_wire_write_byte(CMD_CONVERT_TEMPERATURE);
-    while(!drv_one_wire_read_bit());
 
     return result;
 }
 
 /**
- * @brief Read temperature from the one sensor with matching ROM
+ * @brief Set the resolution of the sensor with Write Scratchpad. Alarm
+ *      thresholds TH and TL are written back unchanged
  * 
- * @param rom[in] Sensors ROM
- * @param temperature[out] Temperature value
- * @return result_t RESULT_OK if temperature was read out
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM
+ * @param bits[in] The resolution, DS18B20_RESOLUTION_MIN..DS18B20_RESOLUTION_MAX bits
+ * @param is_persistent[in] TRUE to copy the scratch pad to EEPROM, so the
+ *      resolution survives power cycle
+ * @return result_t RESULT_OK if the sensor reads back the new resolution
  */
-result_t hal_ds18b20_read_temperature(hal_ds18b20_rom_t * rom, float * temperature) 
+result_t hal_ds18b20_set_resolution(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, uint8_t bits, BOOL is_persistent)
 {
-    result_t result = RESULT_OK;
-    volatile static hal_ds18b20_scratch_pad_t scratch;
+    hal_ds18b20_family_t const * family = _get_family(_find_driver(rom->family));
+    hal_ds18b20_scratch_pad_t scratch;
+    uint8_t configuration;
+
+    if (!family || !family->is_configurable || bits < DS18B20_RESOLUTION_MIN || bits > DS18B20_RESOLUTION_MAX)
+    {
+        return RESULT_FAIL;
+    }
+
+    configuration = ((bits - DS18B20_RESOLUTION_MIN) << DS18B20_RESOLUTION_SHIFT) | DS18B20_CONFIGURATION_RESERVED;
 
-    result = hal_ds18b20_convert_temperature(rom);
+    result_t result = hal_ds18b20_read_scratch(hal, rom, &scratch, 0);
     if (result != RESULT_OK)
     {
         return result;
     }
 
-    result = hal_ds18b20_read_scratch(rom, (hal_ds18b20_scratch_pad_t *)&scratch, 0);
+    return _write_scratch(hal, rom, scratch.page_0.th_register, scratch.page_0.tl_register, configuration, is_persistent);
+}
+
+/**
+ * @brief Set the alarm thresholds of the sensor. After every conversion the
+ *      sensor sets its alarm flag if the temperature is at or above TH or at
+ *      or below TL, whole degrees are compared. Resolution is kept
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM
+ * @param high[in] TH, C
+ * @param low[in] TL, C
+ * @param is_persistent[in] TRUE to copy the thresholds to EEPROM
+ * @return result_t RESULT_OK if the sensor reads back the new thresholds
+ */
+result_t hal_ds18b20_set_alarm(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, int8_t high, int8_t low, BOOL is_persistent)
+{
+    hal_ds18b20_scratch_pad_t scratch;
+
+    result_t result = hal_ds18b20_read_scratch(hal, rom, &scratch, 0);
     if (result != RESULT_OK)
     {
         return result;
     }
 
-    int32_t sign = scratch.page_0.temp_msb & 0x8 ? 0xFFFF<<16 : 0;
-    volatile int32_t int_part = (int32_t)(scratch.page_0.temp_msb << 8 | scratch.page_0.temp_lsb);
-    int_part |= sign;
-    *temperature = int_part / 16.0;
+    return _write_scratch(hal, rom, (uint8_t)high, (uint8_t)low, scratch.page_0.configuration_register, is_persistent);
+}
+
+/**
+ * @brief Get the maximum conversion time for the resolution
+ * 
+ * @param configuration[in] Configuration register of the sensor
+ * @return uint16_t Conversion time, ms
+ */
+uint16_t hal_ds18b20_get_conversion_time(uint8_t configuration)
+{
+    // 9, 10, 11 and 12 bit resolution
+    static const uint16_t conversion_time_ms[] = {94, 188, 375, 750};
+
+    return conversion_time_ms[(configuration >> DS18B20_RESOLUTION_SHIFT) & DS18B20_RESOLUTION_MASK];
+}
+
+/**
+ * @brief Get the conversion time of the sensor, for broadcast the time of
+ *      the slowest sensor
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM or DS18B20_BROADCAST_ROM
+ * @return uint16_t Conversion time, ms
+ */
+static uint16_t _get_conversion_time_ms(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom)
+{
+    uint16_t time_ms = 0;
+    BOOL is_found = FALSE;
+
+    for (uint32_t i = 0; i < hal->sensors.count; i++)
+    {
+        hal_ds18b20_family_t const * family = _get_family(hal->sensors.driver[i]);
+
+        if (family && family->get_conversion_time &&
+            (rom->qw == DS18B20_BROADCAST_ROM || rom->qw == hal->sensors.rom[i].qw))
+        {
+            time_ms = MAX(time_ms, family->get_conversion_time(hal->sensors.configuration[i]));
+            is_found = TRUE;
+        }
+    }
+
+    return is_found ? time_ms : hal_ds18b20_get_conversion_time(DS18B20_CONFIGURATION_12BIT);
+}
+
+/**
+ * @brief Sleep for the time rounded up to whole ticks. vTaskDelay() of N
+ *      ticks may return up to one tick early, so one tick is added
+ * 
+ * @param time_ms The time, ms
+ */
+static void _sleep_ms(uint32_t time_ms)
+{
+    vTaskDelay((time_ms * configTICK_RATE_HZ + 999) / 1000 + 1);
+}
+
+/**
+ * @brief Wait with the bus idle: sleep when the scheduler runs, otherwise
+ *      spin on the cycle counter
+ * 
+ * @param time_ms The time, ms
+ */
+static void _wait_idle_ms(uint32_t time_ms)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+    {
+        _sleep_ms(time_ms);
+    }
+    else
+    {
+        drv_dwt_delay_us(time_ms * 1000UL);
+    }
+}
+
+/**
+ * @brief Wait for the end of conversion on externally powered bus. Sensors
+ *      answer read slots with 0 while converting. In DS18B20_WAIT_SLEEP mode
+ *      the task sleeps for t_CONV with the bus idle and one read slot
+ *      confirms the end, otherwise read slots are sent back to back
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param time_ms[in] Conversion time of the slowest converting sensor, ms
+ * @return result_t RESULT_OK if conversion finished, RESULT_TIMEOUT if the
+ *      sensors are still busy DS18B20_CONVERSION_MARGIN_MS after t_CONV
+ */
+static result_t _wait_conversion(hal_ds18b20_t * hal, uint16_t time_ms)
+{
+    if (hal->wait_mode == DS18B20_WAIT_SLEEP && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+    {
+        uint32_t waited_ms = 0;
+
+        _sleep_ms(time_ms);
+
+        while (!drv_one_wire_read_bit(hal->bus))
+        {
+            if (waited_ms >= DS18B20_CONVERSION_MARGIN_MS)
+            {
+                DEBUG_PRINT("DS18B20: conversion timeout");
+                return RESULT_TIMEOUT;
+            }
+
+            _sleep_ms(DS18B20_RECHECK_MS);
+            waited_ms += DS18B20_RECHECK_MS;
+        }
+
+        return RESULT_OK;
+    }
+
+    uint32_t deadline = drv_dwt_get_deadline((time_ms + DS18B20_CONVERSION_MARGIN_MS) * 1000UL);
+
+    while (!drv_one_wire_read_bit(hal->bus))
+    {
+        if (drv_dwt_is_expired(deadline))
+        {
+            DEBUG_PRINT("DS18B20: conversion timeout");
+            return RESULT_TIMEOUT;
+        }
+    }
+
+    return RESULT_OK;
+}
+
+/**
+ * @brief Get the monotonic time since the scheduler start: the tick count
+ *      extended to 64 bits and refined with the SysTick counter. Must be
+ *      called at least once per tick count wrap, 198 days at 250 Hz
+ * 
+ * @return uint64_t Time, us
+ */
+uint64_t hal_ds18b20_get_timestamp(void)
+{
+    static TickType_t last_ticks;
+    static uint32_t wraps;
+    uint32_t load = SysTick->LOAD;
+    TickType_t ticks;
+    uint32_t cycles;
+
+    taskENTER_CRITICAL();
+    ticks = xTaskGetTickCount();
+    cycles = load - SysTick->VAL;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        // The counter has reloaded, but the tick is not counted yet
+        ticks++;
+        cycles = load - SysTick->VAL;
+    }
+
+    if (ticks < last_ticks)
+    {
+        wraps++;
+    }
+    last_ticks = ticks;
+    taskEXIT_CRITICAL();
+
+    return ((((uint64_t)wraps << 32) | ticks) * (1000000UL / configTICK_RATE_HZ)) +
+        cycles / (configCPU_CLOCK_HZ / 1000000UL);
+}
+
+/**
+ * @brief Convert temperature function sends the command and waits till conversion ends.
+ *      On parasite powered bus strong pull-up is held for the conversion time
+ *      of the sensor resolution (the slowest sensor for broadcast) instead of
+ *      polling read slots. On externally powered bus the wait follows
+ *      hal->wait_mode
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The device we should start conversion
+ * @return result_t RESULT_OK if conversion finished successfully,
+ *      RESULT_TIMEOUT if the sensor is still busy after the conversion time
+ */
+result_t hal_ds18b20_convert_temperature(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom) 
+{
+    BOOL is_broadcast = (rom->qw == DS18B20_BROADCAST_ROM);
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = is_broadcast ? CMD_SKIP_ROM : CMD_MATCH_ROM,
+        .rom = is_broadcast ? 0 : rom->b,
+        .command = CMD_CONVERT_TEMPERATURE
+    };
+
+    if (hal->is_parasite)
+    {
+        // No read slots while converting, the pull-up follows the command at once
+        uint8_t header[ONE_WIRE_HEADER_MAX];
+
+        xDrvOneWireStep_t steps[] = {
+            {.type = DOW_STEP_RESET},
+            {.type = DOW_STEP_WRITE, .tx = header, .length = drv_one_wire_build_header(&transaction, header)},
+            {.type = DOW_STEP_PULLUP, .time_ms = _get_conversion_time_ms(hal, rom)}
+        };
+
+        return drv_one_wire_script(hal->bus, steps, ARRAY_SIZE(steps));
+    }
+
+    result_t result = drv_one_wire_transaction(hal->bus, &transaction);
+    if (result == RESULT_OK)
+    {
+        result = _wait_conversion(hal, _get_conversion_time_ms(hal, rom));
+    }
 
     return result;
 }
 
 /**
- * @brief Read out temperature values from all sensors connected to the 1-Wire interface
+ * @brief Read temperature from the one sensor with matching ROM, or the
+ *      reading of its family like the PIO state
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] Sensors ROM
+ * @param temperature[out] Temperature, 1/16 C
+ * @return result_t RESULT_OK if temperature was read out
+ */
+result_t hal_ds18b20_read_temperature(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, int16_t * temperature) 
+{
+    hal_ds18b20_family_t const * family = _get_family(_find_driver(rom->family));
+    result_t result = RESULT_OK;
+
+    if (!family)
+    {
+        return RESULT_FAIL;
+    }
+
+    if (family->get_conversion_time)
+    {
+        result = hal_ds18b20_convert_temperature(hal, rom);
+        if (result != RESULT_OK)
+        {
+            return result;
+        }
+    }
+
+    return _read_full(hal, family, rom, temperature);
+}
+
+/**
+ * @brief Check if the sensor measures the temperature, the value of the
+ *      others is their own reading like the PIO state
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param i[in] The sensor's index
+ * @return BOOL TRUE for the thermometers
+ */
+BOOL hal_ds18b20_is_thermometer(hal_ds18b20_t const * hal, uint32_t i)
+{
+    hal_ds18b20_family_t const * family = _get_family(hal->sensors.driver[i]);
+
+    return family && family->is_thermometer;
+}
+
+/**
+ * @brief Publish the readings of the bus to the snapshot. Must be called by
+ *      the task sampling the bus only, it never waits for the readers
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param snapshot[out] The snapshot of the bus
+ */
+void hal_ds18b20_publish(hal_ds18b20_t const * hal, hal_ds18b20_snapshot_t * snapshot)
+{
+    hal_ds18b20_table_t const * sensors = &hal->sensors;
+    uint32_t count = sensors->count;
+
+    // Odd sequence tells the readers the copy is in progress
+    snapshot->sequence++;
+    __DMB();
+
+    snapshot->count = count;
+    memcpy(snapshot->value, sensors->value, count * sizeof(sensors->value[0]));
+    memcpy(snapshot->timestamp, sensors->timestamp, count * sizeof(sensors->timestamp[0]));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        snapshot->is_thermometer[i] = hal_ds18b20_is_thermometer(hal, i);
+    }
+
+    __DMB();
+    snapshot->sequence++;
+}
+
+/**
+ * @brief Copy one sensor's reading out of the snapshot without locking. The
+ *      copy is retried if the sampling task published in the meantime, so
+ *      the value and the timestamp always belong together. Any
+ *      task may read at any rate
  * 
- * @return result_t RESULT_OK if all temperatures were read out
+ * @param snapshot[in] The snapshot of the bus
+ * @param i[in] The sensor's index
+ * @param reading[out] The sensor's reading
+ * @return BOOL FALSE if the snapshot has no sensor with the index
  */
-result_t hal_ds18b20_read_all_temperatures(void)
+BOOL hal_ds18b20_snapshot_read(hal_ds18b20_snapshot_t const * snapshot, uint32_t i, hal_ds18b20_reading_t * reading)
 {
-    for (uint8_t i = 0; i < _cxt.size; i++)
+    for (;;)
     {
-        if (_cxt.ptr[i].rom.qw)
+        uint32_t sequence = snapshot->sequence;
+        BOOL is_found;
+
+        if (sequence & 1)
+        {
+            // Only a reader of higher priority sees the sampling task
+            // preempted in the middle of the copy, let it finish
+            vTaskDelay(1);
+            continue;
+        }
+        __DMB();
+
+        is_found = (i < snapshot->count);
+        if (is_found)
+        {
+            reading->timestamp = snapshot->timestamp[i];
+            reading->value = snapshot->value[i];
+            reading->is_thermometer = snapshot->is_thermometer[i];
+        }
+
+        __DMB();
+        if (snapshot->sequence == sequence)
         {
-            volatile float temp;
-            if (hal_ds18b20_read_temperature((hal_ds18b20_rom_t *)&_cxt.ptr[i].rom, (float *)&temp) == RESULT_OK)
+            return is_found;
+        }
+    }
+}
+
+/**
+ * @brief Format the temperature as sign, integer part and four decimals,
+ *      like "+23.0625". 1/16 C is exactly 625/10000 C, so no rounding is needed
+ * 
+ * @param temperature[in] Temperature, 1/16 C
+ * @param buffer[out] The string, DS18B20_TEMPERATURE_STR_SIZE bytes
+ * @return uint32_t The length of the string without terminating zero
+ */
+uint32_t hal_ds18b20_format_temperature(int16_t temperature, uint8_t buffer[DS18B20_TEMPERATURE_STR_SIZE])
+{
+    uint32_t magnitude = (temperature < 0) ? -(int32_t)temperature : temperature;
+    uint32_t integer = magnitude >> DS18B20_FRACTION_BITS;
+    uint32_t fraction = (magnitude & ((1 << DS18B20_FRACTION_BITS) - 1)) * 625;
+    uint8_t digits[4];
+    uint32_t count = 0;
+    uint32_t len = 0;
+
+    buffer[len++] = (temperature < 0) ? '-' : '+';
+
+    do
+    {
+        digits[count++] = '0' + integer % 10;
+        integer /= 10;
+    } while (integer);
+
+    while (count)
+    {
+        buffer[len++] = digits[--count];
+    }
+
+    buffer[len++] = '.';
+    for (uint32_t divider = 1000; divider; divider /= 10)
+    {
+        buffer[len++] = '0' + fraction / divider % 10;
+    }
+
+    buffer[len] = '\0';
+
+    return len;
+}
+
+#if DS18B20_FLOAT_ACCESSOR
+/**
+ * @brief Convert the temperature to degrees Celsius in float. Pulls soft-float
+ *      in, use the integer value where possible
+ * 
+ * @param temperature[in] Temperature, 1/16 C
+ * @return float Temperature, C
+ */
+float hal_ds18b20_to_celsius(int16_t temperature)
+{
+    return temperature / 16.0f;
+}
+#endif
+
+/**
+ * @brief Read scratch pads of the devices of one family with one script:
+ *      reset, match ROM with the family's read command and its full read for
+ *      every device. Fast reads take only the temperature bytes, the next
+ *      reset ends the read. The families recalling memory before the read
+ *      get the recall one by one first, it keeps the script small
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param family[in] The driver of the devices
+ * @param index[in] Indexes of the devices to read in the sensors table
+ * @param count[in] The amount of devices, up to DS18B20_SWEEP_SIZE
+ * @param is_full[in] TRUE for the devices to read the whole scratch pad
+ * @param scratch[out] Scratch pads of the devices
+ * @return result_t RESULT_OK if the script completed. CRC is not checked
+ */
+static result_t _read_scratch_sweep(hal_ds18b20_t * hal, hal_ds18b20_family_t const * family, uint32_t const * index,
+    uint32_t count, BOOL const * is_full, hal_ds18b20_scratch_pad_t * scratch)
+{
+    xDrvOneWireStep_t * steps = hal->sweep.steps;
+    uint8_t (* header)[DS18B20_SWEEP_HEADER_SIZE] = hal->sweep.header;
+    xDrvOneWireStep_t * step = steps;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        hal_ds18b20_rom_t const * rom = &hal->sensors.rom[index[i]];
+
+        result_t result = _recall(hal, family, rom);
+        if (result != RESULT_OK)
+        {
+            return result;
+        }
+
+        header[i][0] = CMD_MATCH_ROM;
+        memcpy(&header[i][1], rom->b, ONE_WIRE_ROM_SIZE);
+        memcpy(&header[i][1 + ONE_WIRE_ROM_SIZE], family->read_command, family->read_command_length);
+
+        *step++ = (xDrvOneWireStep_t){.type = DOW_STEP_RESET};
+        *step++ = (xDrvOneWireStep_t){.type = DOW_STEP_WRITE, .tx = header[i], 
+            .length = 1 + ONE_WIRE_ROM_SIZE + family->read_command_length};
+        *step++ = (xDrvOneWireStep_t){.type = DOW_STEP_READ, .rx = (uint8_t *)&scratch[i], 
+            .length = is_full[i] ? family->read_length : DS18B20_FAST_READ_LENGTH};
+    }
+
+    if (count && !is_full[count - 1])
+    {
+        *step++ = (xDrvOneWireStep_t){.type = DOW_STEP_RESET};
+    }
+
+    return drv_one_wire_script(hal->bus, steps, step - steps);
+}
+
+/**
+ * @brief Decide whether the next read of the sensor must be the full CRC
+ *      checked one: always in full read mode, after a failed read and every
+ *      DS18B20_FULL_READ_PERIOD reads. Only the families with the DS18B20
+ *      scratch pad layout have the fast read
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param family[in] The sensor's driver
+ * @param i[in] The sensor's index
+ * @return BOOL TRUE for full read
+ */
+static BOOL _is_full_read_due(hal_ds18b20_t * hal, hal_ds18b20_family_t const * family, uint32_t i)
+{
+    return hal->read_mode == DS18B20_READ_FULL || !family->is_configurable ||
+        hal->sensors.value[i] == DS18B20_TEMPERATURE_INVALID ||
+        hal->sensors.fast_reads[i] >= DS18B20_FULL_READ_PERIOD - 1;
+}
+
+/**
+ * @brief Check the temperature of fast read without CRC. Only the jump from
+ *      the last value is suspicious: all ones is a valid -0.0625 C, a sensor
+ *      that doesn't answer reads all ones in the whole scratch pad, which
+ *      fails the CRC of the verifying or the next periodic full read
+ * 
+ * @param previous[in] The last temperature of the sensor, 1/16 C
+ * @param temperature[in] The new temperature, 1/16 C
+ * @return BOOL TRUE if the value must be verified with full read
+ */
+static BOOL _is_implausible(int16_t previous, int16_t temperature)
+{
+    return abs(temperature - previous) > DS18B20_MAX_JUMP;
+}
+
+/**
+ * @brief Check whether the sensor is read by this sweep. A quarantined
+ *      sensor skips the sweeps until its quarantine runs out, then it is
+ *      probed with one read
+ * 
+ * @param sensors[in] The sensors table
+ * @param i[in] The sensor's index
+ * @return BOOL TRUE if the sensor must be read
+ */
+static BOOL _is_sweep_due(hal_ds18b20_table_t * sensors, uint32_t i)
+{
+    if (sensors->quarantine[i])
+    {
+        sensors->quarantine[i]--;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Check whether the adaptive sampling period of the sensor is over
+ * 
+ * @param sensors[in] The sensors table
+ * @param i[in] The sensor's index
+ * @return BOOL TRUE if the sensor must be read
+ */
+static BOOL _is_sample_due(hal_ds18b20_table_t * sensors, uint32_t i)
+{
+    if (sensors->wait[i])
+    {
+        sensors->wait[i]--;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Adapt the sampling period of the thermometer to its change since the
+ *      last read. Above hal->slope per sweep the sensor is read every sweep,
+ *      below half of it the period doubles up to hal->max_period. Switches
+ *      and the sensors without the previous value are read every sweep
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param family[in] The sensor's driver
+ * @param i[in] The sensor's index
+ * @param value[in] The new value, the table still has the previous one
+ */
+static void _adapt_period(hal_ds18b20_t * hal, hal_ds18b20_family_t const * family, uint32_t i, int16_t value)
+{
+    hal_ds18b20_table_t * sensors = &hal->sensors;
+    uint32_t period = MAX(sensors->period[i], 1);
+    uint32_t change = abs(value - sensors->value[i]);
+
+    if (hal->max_period <= 1 || !family->is_thermometer || sensors->value[i] == DS18B20_TEMPERATURE_INVALID ||
+        change > hal->slope * period)
+    {
+        period = 1;
+    }
+    else if (change * 2 <= hal->slope * period)
+    {
+        period = MIN(period * 2, hal->max_period);
+    }
+
+    sensors->period[i] = period;
+    sensors->wait[i] = period - 1;
+}
+
+/**
+ * @brief Count the read of the sensor in its health. After
+ *      DS18B20_QUARANTINE_FAILURES failed sweeps in a row the sensor is
+ *      quarantined, every failed probe doubles the quarantine up to
+ *      1 << DS18B20_QUARANTINE_MAX_SHIFT sweeps. A valid read makes the
+ *      sensor healthy again
+ * 
+ * @param sensors[in] The sensors table
+ * @param i[in] The sensor's index
+ * @param is_valid[in] TRUE if the read was valid
+ */
+static void _update_health(hal_ds18b20_table_t * sensors, uint32_t i, BOOL is_valid)
+{
+    if (is_valid)
+    {
+        sensors->failures[i] = 0;
+        sensors->backoff[i] = 0;
+        return;
+    }
+
+    if (sensors->errors[i] < UINT16_MAX)
+    {
+        sensors->errors[i]++;
+    }
+
+    if (sensors->failures[i] < UINT8_MAX)
+    {
+        sensors->failures[i]++;
+    }
+
+    if (sensors->failures[i] >= DS18B20_QUARANTINE_FAILURES)
+    {
+        sensors->quarantine[i] = 1 << sensors->backoff[i];
+        sensors->backoff[i] = MIN(sensors->backoff[i] + 1, DS18B20_QUARANTINE_MAX_SHIFT);
+    }
+}
+
+/**
+ * @brief Read out temperature values from all sensors connected to the 1-Wire interface.
+ *      In DS18B20_SWEEP_BROADCAST mode all sensors are converted at once with
+ *      Skip ROM, in DS18B20_SWEEP_SEQUENTIAL mode one by one. Then the devices
+ *      are read family by family, up to DS18B20_SWEEP_SIZE devices of the
+ *      family with one script, and decoded by their driver. Devices without
+ *      conversion, like DS2413, are only read. In DS18B20_READ_FAST mode
+ *      only the temperature is read, every DS18B20_FULL_READ_PERIOD read, the
+ *      read after a failure and the read with implausible jump are full CRC
+ *      checked reads. A failed read of a healthy sensor is retried up to
+ *      DS18B20_READ_RETRIES times, the sensors failing sweep after sweep are
+ *      quarantined and only probed with backoff, so a bad cable doesn't
+ *      stretch the sweep. With hal->max_period above 1 the thermometers are
+ *      sampled adaptively, only the sensors due in this sweep are converted
+ *      in sequential mode and read. Every valid value gets the timestamp of
+ *      its conversion start, of the read for the devices without conversion.
+ *      Devices of unknown families are skipped. A failed broadcast conversion
+ *      is a bus failure, not a failure of every sensor: it is counted in
+ *      hal->broadcast_failures and the thermometers skip the sweep with
+ *      their health and last values untouched
+ * 
+ * @param hal[in] The sensors bus instance
+ * @return result_t RESULT_OK if all values were read out
+ */
+result_t hal_ds18b20_read_all_temperatures(hal_ds18b20_t * hal)
+{
+    hal_ds18b20_table_t * sensors = &hal->sensors;
+    BOOL is_broadcast = (hal->sweep_mode == DS18B20_SWEEP_BROADCAST);
+    BOOL is_all_converted = FALSE;
+    uint64_t all_converted_at = 0;
+    result_t sweep_result = RESULT_OK;
+
+    if (is_broadcast)
+    {
+        hal_ds18b20_rom_t broadcast = {.qw = DS18B20_BROADCAST_ROM};
+
+        // Waits once for the slowest resolution on the bus
+        all_converted_at = hal_ds18b20_get_timestamp();
+        is_all_converted = (hal_ds18b20_convert_temperature(hal, &broadcast) == RESULT_OK);
+
+        if (!is_all_converted)
+        {
+            hal->broadcast_failures++;
+            sweep_result = RESULT_FAIL;
+        }
+    }
+
+    for (uint8_t driver = 0; driver < ARRAY_SIZE(_families); driver++)
+    {
+        hal_ds18b20_family_t const * family = &_families[driver];
+        uint32_t next = 0;
+
+        if (is_broadcast && !is_all_converted && family->get_conversion_time)
+        {
+            continue;
+        }
+
+        while (next < sensors->count)
+        {
+            hal_ds18b20_scratch_pad_t scratch[DS18B20_SWEEP_SIZE];
+            uint32_t index[DS18B20_SWEEP_SIZE];
+            uint64_t converted_at[DS18B20_SWEEP_SIZE];
+            BOOL is_converted[DS18B20_SWEEP_SIZE];
+            BOOL is_full[DS18B20_SWEEP_SIZE];
+            uint32_t count = 0;
+
+            for (; next < sensors->count && count < DS18B20_SWEEP_SIZE; next++)
             {
-                _cxt.ptr[i].temperature = temp;
+                if (sensors->driver[next] != driver)
+                {
+                    continue;
+                }
+
+                if (!_is_sweep_due(sensors, next))
+                {
+                    sweep_result = RESULT_FAIL;
+                }
+                else if (_is_sample_due(sensors, next))
+                {
+                    index[count++] = next;
+                }
             }
-            else
+
+            for (uint32_t i = 0; i < count; i++)
             {
-                _cxt.ptr[i].temperature = -273.0;
+                if (!family->get_conversion_time)
+                {
+                    converted_at[i] = hal_ds18b20_get_timestamp();
+                    is_converted[i] = TRUE;
+                }
+                else if (is_broadcast)
+                {
+                    converted_at[i] = all_converted_at;
+                    is_converted[i] = is_all_converted;
+                }
+                else
+                {
+                    converted_at[i] = hal_ds18b20_get_timestamp();
+                    is_converted[i] = (hal_ds18b20_convert_temperature(hal, &sensors->rom[index[i]]) == RESULT_OK);
+                }
+                is_full[i] = _is_full_read_due(hal, family, index[i]);
+            }
+
+            result_t result = _read_scratch_sweep(hal, family, index, count, is_full, scratch);
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t n = index[i];
+                BOOL is_valid = (result == RESULT_OK && is_converted[i]);
+                int16_t value = DS18B20_TEMPERATURE_INVALID;
+
+                if (is_valid && !is_full[i])
+                {
+                    // Only the temperature bytes were read, the resolution is known
+                    scratch[i].page_0.configuration_register = sensors->configuration[n];
+                    sensors->fast_reads[n]++;
+                    value = _decode_temperature(&scratch[i]);
+
+                    if (_is_implausible(sensors->value[n], value))
+                    {
+                        is_full[i] = TRUE;
+                        is_valid = (_read_full(hal, family, &sensors->rom[n], &value) == RESULT_OK);
+                    }
+                }
+                else if (is_valid)
+                {
+                    is_valid = family->decode((uint8_t const *)&scratch[i], &value);
+                }
+
+                // The conversion result stays in the scratch pad, only the read is repeated
+                for (uint32_t retry = 0; !is_valid && is_converted[i] && !sensors->backoff[n] &&
+                    retry < DS18B20_READ_RETRIES; retry++)
+                {
+                    is_full[i] = TRUE;
+                    is_valid = (_read_full(hal, family, &sensors->rom[n], &value) == RESULT_OK);
+                }
+
+                _update_health(sensors, n, is_valid);
+
+                if (is_valid)
+                {
+                    _adapt_period(hal, family, n, value);
+                    sensors->value[n] = value;
+                    sensors->timestamp[n] = converted_at[i];
+                    if (is_full[i])
+                    {
+                        sensors->fast_reads[n] = 0;
+                    }
+                }
+                else
+                {
+                    sensors->value[n] = DS18B20_TEMPERATURE_INVALID;
+                    sweep_result = RESULT_FAIL;
+                }
             }
         }
+    }
+
+    return sweep_result;
+}
+
+/**
+ * @brief Check the sensors against their alarm thresholds. All sensors are
+ *      converted with one broadcast Convert T, then Alarm Search finds the
+ *      sensors out of their TH..TL range and only they are read. The other
+ *      sensors keep their last temperature
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param alarms[out] The amount of sensors in alarm
+ * @return result_t RESULT_OK if the conversion and the search completed
+ */
+result_t hal_ds18b20_monitor(hal_ds18b20_t * hal, uint32_t * alarms)
+{
+    hal_ds18b20_rom_t broadcast = {.qw = DS18B20_BROADCAST_ROM};
+    uint64_t converted_at = hal_ds18b20_get_timestamp();
+    uint64_t rom = 0;
+
+    *alarms = 0;
+
+    result_t result = hal_ds18b20_convert_temperature(hal, &broadcast);
+    if (result != RESULT_OK)
+    {
+        return result;
+    }
+
+    memset(hal->sensors.is_alarm, FALSE, sizeof(hal->sensors.is_alarm));
+
+    _reset_search_rom_cxt(&hal->search);
+    while (*alarms < hal->sensors.count && _search_one_rom(hal, &hal->search, CMD_ALARM_SEARCH, &rom) == RESULT_SUCCESS && rom)
+    {
+        hal_ds18b20_family_t const * family;
+        uint32_t i;
+
+        if (!_find_sensor(hal, rom, &i))
+        {
+            DEBUG_PRINT("Unknown sensor in alarm: 0x%08x%08x", UPPER32(rom), LOWER32(rom));
+            continue;
+        }
+
+        hal->sensors.is_alarm[i] = TRUE;
+        (*alarms)++;
+
+        family = _get_family(hal->sensors.driver[i]);
+        if (!family || _read_full(hal, family, &hal->sensors.rom[i], &hal->sensors.value[i]) != RESULT_OK)
+        {
+            hal->sensors.value[i] = DS18B20_TEMPERATURE_INVALID;
+        }
         else
         {
-            break;
+            hal->sensors.timestamp[i] = converted_at;
         }
-        
     }
 
     return RESULT_OK;
+}
+
+/**
+ * @brief Read out temperature of one sensor on every bus of the parallel master.
+ *      Conversion is broadcast to all sensors of the buses, then match ROM and
+ *      scratch pad read run on all buses in the same slots. The bytes of all
+ *      buses, 160 bytes, are kept on the caller's stack
+ * 
+ * @param parallel[in] The parallel 1-Wire master
+ * @param rom[in] ROM of the sensor for every bus pin, 0 to skip the bus
+ * @param temperature[out] Temperature for every bus pin, 1/16 C,
+ *      DS18B20_TEMPERATURE_INVALID on failure
+ * @return uint16_t The mask of buses the temperature was read from
+ */
+uint16_t hal_ds18b20_read_temperatures_parallel(xDrvOneWireParallel_t * parallel, 
+    hal_ds18b20_rom_t const rom[ONE_WIRE_PARALLEL_BUS_NUM], int16_t temperature[ONE_WIRE_PARALLEL_BUS_NUM])
+{
+    xDrvOneWireParallelData_t data[ONE_WIRE_HEADER_MAX];
+    uint16_t pins = 0;
+    uint16_t busy;
+
+    for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+    {
+        temperature[pin] = DS18B20_TEMPERATURE_INVALID;
+        if (rom[pin].qw)
+        {
+            pins |= 1 << pin;
+        }
+    }
+
+    pins = drv_one_wire_parallel_reset(parallel, pins);
+    memset(data, CMD_SKIP_ROM, sizeof(data[0]));
+    memset(data[1], CMD_CONVERT_TEMPERATURE, sizeof(data[1]));
+    if (drv_one_wire_parallel_touch(parallel, pins, data, 2) != RESULT_OK)
+    {
+        return 0;
+    }
+
+    // Sensors hold the line low while converting. The buses stay idle for the
+    // longest conversion time, then one read run confirms the end, the buses
+    // still busy after the margin are dropped
+    for (uint32_t waited_ms = 0; ; waited_ms += DS18B20_RECHECK_MS)
+    {
+        _wait_idle_ms(waited_ms ? DS18B20_RECHECK_MS : hal_ds18b20_get_conversion_time(DS18B20_CONFIGURATION_12BIT));
+
+        memset(data, 0xFF, sizeof(data[0]));
+        if (drv_one_wire_parallel_touch(parallel, pins, data, 1) != RESULT_OK)
+        {
+            return 0;
+        }
+
+        busy = 0;
+        for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+        {
+            if ((pins & (1 << pin)) && data[0][pin] != 0xFF)
+            {
+                busy |= 1 << pin;
+            }
+        }
+        if (!busy || waited_ms >= DS18B20_CONVERSION_MARGIN_MS)
+        {
+            pins &= ~busy;
+            break;
+        }
+    }
+
+    pins = drv_one_wire_parallel_reset(parallel, pins);
+    for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+    {
+        data[0][pin] = CMD_MATCH_ROM;
+        for (uint8_t i = 0; i < ONE_WIRE_ROM_SIZE; i++)
+        {
+            data[1 + i][pin] = rom[pin].b[i];
+        }
+        data[1 + ONE_WIRE_ROM_SIZE][pin] = CMD_READ_SCRATCHPAD;
+    }
+    if (drv_one_wire_parallel_touch(parallel, pins, data, ONE_WIRE_HEADER_MAX) != RESULT_OK)
+    {
+        return 0;
+    }
+
+    memset(data, 0xFF, sizeof(hal_ds18b20_scratch_pad_t) * sizeof(data[0]));
+    if (drv_one_wire_parallel_touch(parallel, pins, data, sizeof(hal_ds18b20_scratch_pad_t)) != RESULT_OK)
+    {
+        return 0;
+    }
+
+    for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+    {
+        hal_ds18b20_scratch_pad_t scratch;
+
+        if (!(pins & (1 << pin)))
+        {
+            continue;
+        }
+
+        for (uint8_t i = 0; i < sizeof(scratch); i++)
+        {
+            ((uint8_t *)&scratch)[i] = data[i][pin];
+        }
+
+        if (_calculate_crc8((uint8_t *)&scratch, sizeof(scratch)) != 0)
+        {
+            pins &= ~(1 << pin);
+            continue;
+        }
+
+        temperature[pin] = _decode_temperature(&scratch);
+    }
+
+    return pins;
 }
\ No newline at end of file
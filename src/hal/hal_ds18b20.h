@@ -12,6 +12,9 @@
 #define _HAL_DS18B20_
 
 #include "types.h"
+#include "config.h"
+#include "drv_one_wire.h"
+#include "drv_one_wire_parallel.h"
 #include  <stdint.h>
 
 #define CMD_READ_ROM                0x33
@@ -26,6 +29,31 @@
 #define CMD_COPY_SCRATCHPAD         0x48
 #define CMD_RECALL_E2               0xB8
 #define CMD_READ_POWER_SUPPLY       0xB4
+#define CMD_PIO_ACCESS_READ         0xF5        //DS2413
+
+// ROM family codes of the devices with drivers
+#define FAMILY_DS18S20              0x10
+#define FAMILY_DS1822               0x22
+#define FAMILY_DS2438               0x26
+#define FAMILY_DS18B20              0x28
+#define FAMILY_DS2413               0x3A
+#define DS18B20_NO_DRIVER           0xFF        //The family has no driver, the device is not read
+
+#define DS18B20_CONFIGURATION_12BIT 0x7F        //Power-on default configuration register
+#define DS18B20_RESOLUTION_SHIFT    5           //R1:R0 bits of configuration register
+#define DS18B20_RESOLUTION_MASK     0x03
+#define DS18B20_RESOLUTION_MIN      9           //0.5 C, 94 ms conversion
+#define DS18B20_RESOLUTION_MAX      12          //0.0625 C, 750 ms conversion
+
+#define DS18B20_FRACTION_BITS       4           //Temperature LSB is 1/16 C
+#define DS18B20_TEMPERATURE_INVALID (-273 * 16) //Temperature of the sensor that failed to read, 1/16 C
+#define DS18B20_TEMPERATURE_STR_SIZE 11         //"-2048.0000" with terminating zero
+
+#define DS18B20_ROM_CACHE_MAGIC     0x524F4D31  //"ROM1", the cache layout version
+
+#define DS18B20_SWEEP_SIZE          4           //Sensors read by one script
+#define DS18B20_SWEEP_STEPS         3           //Reset, match ROM with command, read
+#define DS18B20_SWEEP_HEADER_SIZE   (1 + ONE_WIRE_ROM_SIZE + 2) //Match ROM, ROM and the longest read command
 
 #define DS18B20_INVALID_ROM         0xFFFFFFFFFFFFFFFFULL
 #define DS18B20_BROADCAST_ROM       0xFFFFFFFFFFFFFFFFULL
@@ -60,89 +88,396 @@ typedef struct  {
     } page_0;
 } hal_ds18b20_scratch_pad_t;
 
-typedef struct 
+// Sensors of one bus, the index is the same in every array. ROMs are used by
+// searches and Match ROM only, the sweeps and the readers go through the
+// dense arrays of the values and the status
+typedef struct
+{
+    uint32_t count;
+    int16_t value[DS18B20_MAX_SENSORS];             //Temperature, 1/16 C, or PIO state of a switch.
+                                                    //DS18B20_TEMPERATURE_INVALID if the last read failed
+    uint8_t driver[DS18B20_MAX_SENSORS];            //Family driver index, DS18B20_NO_DRIVER if not supported
+    uint8_t configuration[DS18B20_MAX_SENSORS];     //Configuration register, selects resolution and conversion time
+    uint8_t fast_reads[DS18B20_MAX_SENSORS];        //Reads without CRC since the last full read
+    BOOL8 is_alarm[DS18B20_MAX_SENSORS];            //Found by the last alarm search of hal_ds18b20_monitor()
+    uint8_t seen_pass[DS18B20_MAX_SENSORS];         //Rescan pass that found the sensor last time
+    uint8_t failures[DS18B20_MAX_SENSORS];          //Failed sweep reads in a row, CRC or no answer
+    uint16_t errors[DS18B20_MAX_SENSORS];           //Failed sweep reads in total, saturates
+    uint8_t quarantine[DS18B20_MAX_SENSORS];        //Sweeps to skip before the next probe, 0 if read every sweep
+    uint8_t backoff[DS18B20_MAX_SENSORS];           //Quarantine is 1 << backoff sweeps, 0 if the sensor is healthy
+    uint8_t period[DS18B20_MAX_SENSORS];            //Sweeps between the reads, adapted to the rate of change
+    uint8_t wait[DS18B20_MAX_SENSORS];              //Sweeps to skip before the next read
+    hal_ds18b20_rom_t rom[DS18B20_MAX_SENSORS];
+    uint64_t timestamp[DS18B20_MAX_SENSORS];        //Conversion start of the value, us, see hal_ds18b20_get_timestamp()
+} hal_ds18b20_table_t;
+
+// Driver of one device family. Thermometers take part in Convert T, every
+// family is read with its own command and decoded with its own rule
+typedef struct
+{
+    uint8_t family;                 //ROM family code
+    uint8_t recall_command[2];      //Copies the memory page to the scratch pad before the read
+    uint8_t recall_command_length;  //0 if the read needs no recall
+    uint8_t read_command[2];        //Function command of the read with its parameter
+    uint8_t read_command_length;
+    uint8_t read_length;            //Full read, bytes
+    BOOL8 is_thermometer;           //Converts with Convert T, the value is 1/16 C
+    BOOL8 is_configurable;          //Has the configuration register, may be read fast
+    BOOL8 has_alarm;                //Has TH and TL, answers Alarm Search
+    uint16_t (*get_conversion_time)(uint8_t configuration); //ms, 0 if the family does not convert
+    BOOL (*decode)(uint8_t const * data, int16_t * value);  //Check the full read and get the value
+} hal_ds18b20_family_t;
+
+typedef enum
+{
+    DS18B20_SWEEP_BROADCAST,    //One Skip ROM Convert T for all sensors, then read them one by one
+    DS18B20_SWEEP_SEQUENTIAL    //Match ROM Convert T and wait for every sensor, least current at once
+} hal_ds18b20_sweep_mode_t;
+
+typedef enum
+{
+    DS18B20_WAIT_SLEEP,         //Sleep for t_CONV with the bus idle, then confirm with one read slot
+    DS18B20_WAIT_POLL           //Send read slots back to back until the sensors are ready
+} hal_ds18b20_wait_mode_t;
+
+typedef enum
+{
+    DS18B20_READ_FULL,          //Read all 9 bytes of scratch pad and check CRC every time
+    DS18B20_READ_FAST           //Read the temperature bytes only, full read from time to time
+} hal_ds18b20_read_mode_t;
+
+// ROMs of the bus kept in non-volatile memory, checked at boot instead of search
+typedef struct
+{
+    uint32_t magic;             //DS18B20_ROM_CACHE_MAGIC
+    uint32_t count;
+    uint64_t rom[DS18B20_MAX_SENSORS];
+    uint16_t crc;               //CRC-16 of the fields above
+} hal_ds18b20_rom_cache_t;
+
+// ROM search state, one search may be resumed while others run in between
+typedef struct
+{
+    uint32_t last_discrepancy;
+    uint32_t last_family_discrepancy;
+    BOOL is_last_device;
+    uint8_t crc8;
+} hal_ds18b20_search_t;
+
+// Sensors of one 1-Wire bus. Every bus has its own instance, so buses may be
+// used from different tasks at the same time
+typedef struct
+{
+    xDrvOneWireBus_t * bus;
+    hal_ds18b20_table_t sensors;
+    BOOL is_parasite;           //Some sensors are parasite powered, conversions need strong pull-up
+    hal_ds18b20_sweep_mode_t sweep_mode;    //How hal_ds18b20_read_all_temperatures() converts, broadcast after init
+    hal_ds18b20_wait_mode_t wait_mode;      //How the end of conversion is awaited, sleep after init
+    hal_ds18b20_read_mode_t read_mode;      //How scratch pads are read by the sweep, full after init
+    uint8_t max_period;         //Sweeps between reads of a stable thermometer, 0 or 1 to read every sweep
+    uint16_t slope;             //Change per sweep, 1/16 C, above which the thermometer is read every sweep
+    uint32_t broadcast_failures;    //Broadcast conversions that failed, the thermometers skipped the sweep
+
+    // Script of _read_scratch_sweep(), kept off the task stack
+    struct
+    {
+        xDrvOneWireStep_t steps[DS18B20_SWEEP_SIZE * DS18B20_SWEEP_STEPS + 1];
+        uint8_t header[DS18B20_SWEEP_SIZE][DS18B20_SWEEP_HEADER_SIZE];
+    } sweep;
+
+    // ROM search state
+    hal_ds18b20_search_t search;
+
+    // Background rescan state, see hal_ds18b20_rescan()
+    struct
+    {
+        hal_ds18b20_search_t search;
+        uint64_t rom;           //ROM found by the last step of the running pass
+        uint8_t pass;           //Number of the running pass
+        uint8_t empty_calls;    //Calls in a row that found no presence
+    } rescan;
+} hal_ds18b20_t;
+
+// Latest readings of one bus published by its sampling task for the other
+// tasks. The only writer makes the sequence odd while it copies the readings
+// in, readers copy them out and retry if the sequence was odd or has changed.
+// Every publish overwrites the readings, so a reader slower than the sweeps
+// misses some of them: readers that need every reading take them from the
+// sampling task. Readings are kept by the sensor's index, the ROMs stay in
+// the table only
+typedef struct
 {
-    hal_ds18b20_rom_t rom;
-    float temperature;
-} hal_ds18b20_cxt_t;
+    volatile uint32_t sequence;
+    uint32_t count;
+    int16_t value[DS18B20_MAX_SENSORS];
+    BOOL8 is_thermometer[DS18B20_MAX_SENSORS];
+    uint64_t timestamp[DS18B20_MAX_SENSORS];
+} hal_ds18b20_snapshot_t;
+
+// One sensor's reading copied out of the snapshot
+typedef struct
+{
+    uint64_t timestamp;         //Conversion start, us
+    int16_t value;              //Temperature, 1/16 C, or PIO state
+    BOOL8 is_thermometer;
+} hal_ds18b20_reading_t;
 
 
 /**
  * @brief Initialisation of the sensors' context, interface and obtaining of 
- *      devices' ROM
+ *      devices' ROM. Cached ROMs are checked with one short read per sensor,
+ *      the full search runs only if the cache is broken or a sensor is gone
  * 
- * @param cxt[in/out] Pointer to the context we should initialize with found devices
- * @param size[in] The size of array of the context
+ * @param hal[out] The instance to initialize, the found sensors are in
+ *      hal->sensors
+ * @param bus[in] The 1-Wire bus the sensors are connected to
+ * @param cache[in] ROMs saved by the previous run, 0 to search
  * @return result_t RESULT_OK if initialization succeed
  */
-result_t hal_ds18b20_init(hal_ds18b20_cxt_t * cxt, uint32_t size);
+result_t hal_ds18b20_init(hal_ds18b20_t * hal, xDrvOneWireBus_t * bus, hal_ds18b20_rom_cache_t const * cache);
+
+/**
+ * @brief Make the cache of the sensors' ROMs to save in non-volatile memory
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param cache[out] The cache. Unused bytes are zeroed, so equal tables give
+ *      equal caches
+ */
+void hal_ds18b20_fill_rom_cache(hal_ds18b20_t const * hal, hal_ds18b20_rom_cache_t * cache);
 
 /**
  * @brief This function obtains ROM code of all devices on the 1-Wire line
  * 
+ * @param hal[in] The sensors bus instance
  * @return result_t RESULT_OK if we found all devices without troubles
  */
-result_t hal_ds18b20_search_rom(void);
+result_t hal_ds18b20_search_rom(hal_ds18b20_t * hal);
 
 /**
  * @brief We can read ROM in case if we have only one device on the line
  * 
+ * @param hal[in] The sensors bus instance
  * @param rom[out] Sensor's ROM 
  * @return result_t RESULT_OK if we succeed to get ROM
  */
-result_t hal_ds18b20_read_rom(hal_ds18b20_rom_t * rom);
+result_t hal_ds18b20_read_rom(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom);
 
 /**
  * @brief Before we send any command to the sensor we should choose it
  *      by this command
  * 
+ * @param hal[in] The sensors bus instance
  * @param rom[in] Sensor's ROM
  * @return result_t RESULT_OK if the command was sent successfully
  */
-result_t hal_ds18b20_match_rom(hal_ds18b20_rom_t * rom);
+result_t hal_ds18b20_match_rom(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom);
 
 /**
  * @brief Skip ROM command allows to send broadcast commands or to save time
  *      for the command in case  we have only one device on the line
  * 
+ * @param hal[in] The sensors bus instance
  * @return result_t RESULT_OK if the command was sent successfully
  */
-result_t hal_ds18b20_skip_rom(void);
+result_t hal_ds18b20_skip_rom(hal_ds18b20_t * hal);
 
-void hal_ds18b20_recall_memory(uint8_t page);
+void hal_ds18b20_recall_memory(hal_ds18b20_t * hal, uint8_t page);
 
 /**
  * @brief Reads scratch pad of the sensor
  * 
+ * @param hal[in] The sensors bus instance
  * @param rom[in] The device's ROM
  * @param scratch[out] The struct where to store scratch pad values
  * @param page[in] The number of scratch pad page 
  * @return result_t RESULT_OK if we read out successfully
  */
-result_t hal_ds18b20_read_scratch(hal_ds18b20_rom_t * rom, hal_ds18b20_scratch_pad_t * scratch, uint8_t page);
+result_t hal_ds18b20_read_scratch(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, hal_ds18b20_scratch_pad_t * scratch, uint8_t page);
 
 /**
- * @brief Convert temperature function sends the command and waits till conversion ends
+ * @brief Check whether the sensors are parasite powered with Read Power Supply
  * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor to check, DS18B20_BROADCAST_ROM to check all sensors
+ * @param is_parasite[out] TRUE if the sensor (any sensor for broadcast) is parasite powered
+ * @return result_t RESULT_OK if the command was sent successfully
+ */
+result_t hal_ds18b20_read_power_supply(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, BOOL * is_parasite);
+
+/**
+ * @brief Set the resolution of the sensor with Write Scratchpad. Alarm
+ *      thresholds TH and TL are written back unchanged
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM
+ * @param bits[in] The resolution, DS18B20_RESOLUTION_MIN..DS18B20_RESOLUTION_MAX bits
+ * @param is_persistent[in] TRUE to copy the scratch pad to EEPROM, so the
+ *      resolution survives power cycle
+ * @return result_t RESULT_OK if the sensor reads back the new resolution
+ */
+result_t hal_ds18b20_set_resolution(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, uint8_t bits, BOOL is_persistent);
+
+/**
+ * @brief Walk a few branches of the ROM search tree. Sensors found that are
+ *      not in the table are added, sensors that are not found by
+ *      DS18B20_RESCAN_MISSES complete passes in a row are retired. Call it
+ *      between sweeps to follow the probes plugged and unplugged at run time.
+ *      Missing presence breaks the pass like any bus error, only
+ *      DS18B20_RESCAN_EMPTY_CALLS calls in a row without it make an empty pass
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param steps[in] The maximum amount of ROMs to search, one search takes
+ *      about as long as reading two scratch pads
+ * @return result_t RESULT_OK if the steps completed, the bus error otherwise.
+ *      The pass restarts on the next call after an error
+ */
+result_t hal_ds18b20_rescan(hal_ds18b20_t * hal, uint32_t steps);
+
+/**
+ * @brief Check whether the value of the sensor is the temperature
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param i[in] The sensor's index
+ * @return BOOL TRUE for thermometers, FALSE for switches and unsupported devices
+ */
+BOOL hal_ds18b20_is_thermometer(hal_ds18b20_t const * hal, uint32_t i);
+
+/**
+ * @brief Publish the readings of the bus to the snapshot. Must be called by
+ *      the task sampling the bus only, it never waits for the readers
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param snapshot[out] The snapshot of the bus
+ */
+void hal_ds18b20_publish(hal_ds18b20_t const * hal, hal_ds18b20_snapshot_t * snapshot);
+
+/**
+ * @brief Copy one sensor's reading out of the snapshot without locking. The
+ *      copy is retried if the sampling task published in the meantime, so
+ *      the value and the timestamp always belong together. Any
+ *      task may read the latest reading at any rate
+ * 
+ * @param snapshot[in] The snapshot of the bus
+ * @param i[in] The sensor's index
+ * @param reading[out] The sensor's reading
+ * @return BOOL FALSE if the snapshot has no sensor with the index
+ */
+BOOL hal_ds18b20_snapshot_read(hal_ds18b20_snapshot_t const * snapshot, uint32_t i, hal_ds18b20_reading_t * reading);
+
+/**
+ * @brief Set the alarm thresholds of the sensor. After every conversion the
+ *      sensor sets its alarm flag if the temperature is at or above TH or at
+ *      or below TL, whole degrees are compared. Resolution is kept
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param rom[in] The sensor's ROM
+ * @param high[in] TH, C
+ * @param low[in] TL, C
+ * @param is_persistent[in] TRUE to copy the thresholds to EEPROM
+ * @return result_t RESULT_OK if the sensor reads back the new thresholds
+ */
+result_t hal_ds18b20_set_alarm(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, int8_t high, int8_t low, BOOL is_persistent);
+
+/**
+ * @brief Get the maximum conversion time for the resolution
+ * 
+ * @param configuration[in] Configuration register of the sensor
+ * @return uint16_t Conversion time, ms
+ */
+uint16_t hal_ds18b20_get_conversion_time(uint8_t configuration);
+
+/**
+ * @brief Get the monotonic time since the scheduler start: the tick count
+ *      extended to 64 bits and refined with the SysTick counter. Must be
+ *      called at least once per tick count wrap, 198 days at 250 Hz
+ * 
+ * @return uint64_t Time, us
+ */
+uint64_t hal_ds18b20_get_timestamp(void);
+
+/**
+ * @brief Convert temperature function sends the command and waits till conversion ends.
+ *      On parasite powered bus strong pull-up is held for the conversion time
+ *      of the sensor resolution (the slowest sensor for broadcast) instead of
+ *      polling read slots. On externally powered bus the wait follows
+ *      hal->wait_mode
+ * 
+ * @param hal[in] The sensors bus instance
  * @param rom[in] The device we should start conversion
  * @return result_t RESULT_OK if conversion finished successfully
  */
-result_t hal_ds18b20_convert_temperature(hal_ds18b20_rom_t * rom);
+result_t hal_ds18b20_convert_temperature(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom);
 
 /**
  * @brief Read temperature from the one sensor with matching ROM
  * 
+ * @param hal[in] The sensors bus instance
  * @param rom[in] Sensors ROM
- * @param temperature[out] Temperature value
+ * @param temperature[out] Temperature, 1/16 C
  * @return result_t RESULT_OK if temperature was read out
  */
-result_t hal_ds18b20_read_temperature(hal_ds18b20_rom_t * rom, float * temperature);
+result_t hal_ds18b20_read_temperature(hal_ds18b20_t * hal, hal_ds18b20_rom_t * rom, int16_t * temperature);
+
+/**
+ * @brief Format the temperature as sign, integer part and four decimals,
+ *      like "+23.0625". 1/16 C is exactly 625/10000 C, so no rounding is needed
+ * 
+ * @param temperature[in] Temperature, 1/16 C
+ * @param buffer[out] The string, DS18B20_TEMPERATURE_STR_SIZE bytes
+ * @return uint32_t The length of the string without terminating zero
+ */
+uint32_t hal_ds18b20_format_temperature(int16_t temperature, uint8_t buffer[DS18B20_TEMPERATURE_STR_SIZE]);
+
+#if DS18B20_FLOAT_ACCESSOR
+/**
+ * @brief Convert the temperature to degrees Celsius in float. Pulls soft-float
+ *      in, use the integer value where possible
+ * 
+ * @param temperature[in] Temperature, 1/16 C
+ * @return float Temperature, C
+ */
+float hal_ds18b20_to_celsius(int16_t temperature);
+#endif
 
 /**
- * @brief Read out temperature values from all sensors connected to the 1-Wire interface
+ * @brief Read out temperature values from all sensors connected to the 1-Wire interface.
+ *      In DS18B20_SWEEP_BROADCAST mode all sensors are converted at once with
+ *      Skip ROM, in DS18B20_SWEEP_SEQUENTIAL mode one by one. Then scratch
+ *      pads of up to DS18B20_SWEEP_SIZE sensors are read with one script.
+ *      In DS18B20_READ_FAST mode only the temperature is read, every
+ *      DS18B20_FULL_READ_PERIOD read, the read after a failure and the
+ *      read with implausible jump are full CRC checked reads
  * 
+ * @param hal[in] The sensors bus instance
  * @return result_t RESULT_OK if all temperatures were read out
  */
-result_t hal_ds18b20_read_all_temperatures(void);
+result_t hal_ds18b20_read_all_temperatures(hal_ds18b20_t * hal);
+
+/**
+ * @brief Check the sensors against their alarm thresholds. All sensors are
+ *      converted with one broadcast Convert T, then Alarm Search finds the
+ *      sensors out of their TH..TL range and only they are read. The other
+ *      sensors keep their last temperature
+ * 
+ * @param hal[in] The sensors bus instance
+ * @param alarms[out] The amount of sensors in alarm
+ * @return result_t RESULT_OK if the conversion and the search completed
+ */
+result_t hal_ds18b20_monitor(hal_ds18b20_t * hal, uint32_t * alarms);
+
+/**
+ * @brief Read out temperature of one sensor on every bus of the parallel master.
+ *      Conversion is broadcast to all sensors of the buses, then match ROM and
+ *      scratch pad read run on all buses in the same slots. The bytes of all
+ *      buses, 160 bytes, are kept on the caller's stack
+ * 
+ * @param parallel[in] The parallel 1-Wire master
+ * @param rom[in] ROM of the sensor for every bus pin, 0 to skip the bus
+ * @param temperature[out] Temperature for every bus pin, 1/16 C,
+ *      DS18B20_TEMPERATURE_INVALID on failure
+ * @return uint16_t The mask of buses the temperature was read from
+ */
+uint16_t hal_ds18b20_read_temperatures_parallel(xDrvOneWireParallel_t * parallel, 
+    hal_ds18b20_rom_t const rom[ONE_WIRE_PARALLEL_BUS_NUM], int16_t temperature[ONE_WIRE_PARALLEL_BUS_NUM]);
 
 #endif  //_HAL_DS18B20_
\ No newline at end of file
@@ -1,11 +1,19 @@
 #include "stm32f1xx.h"
 #include "drv_clocks.h"
 #include "drv_usart.h"
+#include "drv_dwt.h"
+#include "drv_flash.h"
 #include "hal_ds18b20.h"
+#include "drv_one_wire_usart.h"
+#include "drv_one_wire_tim.h"
 #include "macro.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
+#include "stream_buffer.h"
+
+#include <string.h>
 
 // Dimensions the buffer that the task being created will use as its stack.
 // NOTE:  This is the number of words the stack will hold, not the number of
@@ -13,6 +21,11 @@
 // then 400 bytes (100 * 32-bits) will be allocated.
 #define STACK_SIZE 200
 
+// Stack of the acquisition tasks, words. The sweep goes through the HAL, the
+// script and the backend transaction down to the wait for its interrupt,
+// about 1 KB deep. Check the free part printed with the bus statistics
+#define TEMPERATURE_STACK_SIZE 320
+
 // Structure that will hold the TCB of the task being created.
 StaticTask_t xTaskBuffer;
 
@@ -23,7 +36,197 @@ StackType_t xStack[ STACK_SIZE ];
 
 
 StaticTask_t xGetTemperatureTaskBuffer;
-StackType_t xGetTemperatureTaskStack[ STACK_SIZE ];
+StackType_t xGetTemperatureTaskStack[ TEMPERATURE_STACK_SIZE ];
+
+StaticTask_t xFormatTaskBuffer;
+StackType_t xFormatTaskStack[ STACK_SIZE ];
+
+StaticTask_t xTransportTaskBuffer;
+StackType_t xTransportTaskStack[ STACK_SIZE ];
+
+// 1-Wire bus of the temperature sensors
+#if ONE_WIRE_BUS_BACKEND == ONE_WIRE_BACKEND_TIM
+static xDrvOneWireTim_t xOneWireTim = DRV_ONE_WIRE_TIM(3, GPIOA, 6);
+static xDrvOneWireBus_t xOneWireBus = {&drv_one_wire_tim_ops, &xOneWireTim};
+#else
+static xDrvOneWireUsart_t xOneWireUsart = DRV_ONE_WIRE_USART(DU_USART2);
+static xDrvOneWireBus_t xOneWireBus = {&drv_one_wire_usart_ops, &xOneWireUsart};
+#endif
+
+// Sensors of one bus, every bus is read by its own task
+typedef struct
+{
+    xDrvOneWireBus_t * bus;
+    uint32_t number;            //1 based, tells the buses apart in the output
+    hal_ds18b20_t hal;          //Holds the sensors table, up to DS18B20_MAX_SENSORS
+    uint32_t rom_cache_slot;    //Flash page of the bus ROMs in the cache
+#if TEMPERATURE_ROM_CACHE
+    uint32_t rom_signature;     //Signature of the table ROMs at the last cycle
+    uint32_t rom_stable;        //Cycles the signature stayed the same
+    uint32_t rom_cached;        //Signature last compared with the cache page
+    TickType_t rom_saved_at;    //Tick of the last rewrite of the cache page
+    BOOL8 is_rom_saved;
+#endif
+    hal_ds18b20_snapshot_t snapshot;    //Latest readings published for the other tasks
+    xDrvOneWireStats_t stats;   //Bus counters at the end of the last sweep, copied for the formatting task
+    UBaseType_t stack_free;     //Least free stack of the acquisition task, words
+} xTemperatureBus_t;
+
+static xTemperatureBus_t xTemperatureBus = {.bus = &xOneWireBus, .number = 1, .rom_cache_slot = 0};
+
+#if ONE_WIRE_SECOND_BUS
+StaticTask_t xGetTemperatureTask2Buffer;
+StackType_t xGetTemperatureTask2Stack[ TEMPERATURE_STACK_SIZE ];
+
+static xDrvOneWireUsart_t xOneWireUsart3 = DRV_ONE_WIRE_USART(DU_USART3);
+static xDrvOneWireBus_t xOneWireBus2 = {&drv_one_wire_usart_ops, &xOneWireUsart3};
+static xTemperatureBus_t xTemperatureBus2 = {.bus = &xOneWireBus2, .number = 2, .rom_cache_slot = 1};
+#endif
+
+#define BUSES_NUM       (1 + ONE_WIRE_SECOND_BUS)
+
+static xTemperatureBus_t * const pxTemperatureBuses[ BUSES_NUM ] = {
+    &xTemperatureBus,
+#if ONE_WIRE_SECOND_BUS
+    &xTemperatureBus2,
+#endif
+};
+
+// Sampling pipeline: the acquisition tasks queue a compact record for every
+// reading of the sweep and one for the end of the sweep, the formatting task
+// turns the records into text for the stream buffer and the transport task
+// writes the text to the UART. The acquisition never waits for the output,
+// the records that don't fit the queue are dropped and counted. The snapshots
+// of the buses are for the readers that want the latest values only
+
+#define SAMPLE_SWEEP_END    0xFF    //Index of the record that ends the sweep of the bus
+#define SAMPLE_PIO          0x80    //Set in the index if the value is the PIO state of a switch
+
+// One reading of the sweep. DS18B20_MAX_SENSORS fits one flash page of the
+// ROM cache, so the index leaves the top bit for SAMPLE_PIO
+typedef struct
+{
+    uint8_t bus;                //Index in pxTemperatureBuses
+    uint8_t index;              //Sensor in the table of the bus with SAMPLE_PIO, or SAMPLE_SWEEP_END
+    int16_t value;              //1/16 C, PIO state or DS18B20_TEMPERATURE_INVALID
+    uint32_t time_ms;           //Conversion start, see hal_ds18b20_get_timestamp()
+} xSampleRecord_t;
+
+_Static_assert(DS18B20_MAX_SENSORS <= SAMPLE_PIO, "Sensor index of the sample record overlaps SAMPLE_PIO");
+
+static StaticQueue_t xSampleQueueBuffer;
+static uint8_t ucSampleQueueStorage[ TEMPERATURE_SAMPLE_QUEUE_LENGTH * sizeof(xSampleRecord_t) ];
+static QueueHandle_t xSampleQueue;
+
+static StaticStreamBuffer_t xTextStreamBuffer;
+static uint8_t ucTextStreamStorage[ TEMPERATURE_TEXT_BUFFER_SIZE + 1 ];
+static StreamBufferHandle_t xTextStream;
+
+// High-water marks of the pipeline, every stage updates its own
+static UBaseType_t uxSampleQueueHighWater;
+static uint32_t ulSamplesDropped;
+static size_t xTextStreamHighWater;
+
+// Static RAM of main: the sensor buses, the tasks with the idle task, the
+// pipeline and the ROM cache buffer of vSaveRomCache(). The linker script
+// checks only its heap and stack, so the tables must be sized to fit here
+#define TASKS_NUM       (5 + ONE_WIRE_SECOND_BUS)
+#define MAIN_RAM_SIZE   (BUSES_NUM * (sizeof(xTemperatureBus_t) + sizeof(xDrvOneWireBus_t) + sizeof(xDrvOneWireUsart_t)) + \
+                         BUSES_NUM * TEMPERATURE_STACK_SIZE * sizeof(StackType_t) + \
+                         (TASKS_NUM - 1 - BUSES_NUM) * STACK_SIZE * sizeof(StackType_t) + \
+                         configMINIMAL_STACK_SIZE * sizeof(StackType_t) + \
+                         TASKS_NUM * sizeof(StaticTask_t) + \
+                         sizeof(xSampleQueueBuffer) + sizeof(ucSampleQueueStorage) + \
+                         sizeof(xTextStreamBuffer) + sizeof(ucTextStreamStorage) + \
+                         TEMPERATURE_ROM_CACHE * sizeof(hal_ds18b20_rom_cache_t))
+
+_Static_assert(MAIN_RAM_SIZE + RAM_RESERVE <= RAM_SIZE, "Static RAM exceeds RAM_SIZE, lower DS18B20_MAX_SENSORS");
+
+#if TEMPERATURE_ROM_CACHE
+// Every bus has its own flash page of the ROM cache
+#define ROM_CACHE_ADDRESS(slot)     (TEMPERATURE_ROM_CACHE_ADDRESS + (slot) * DRV_FLASH_PAGE_SIZE)
+#define pxRomCache(slot)            ((hal_ds18b20_rom_cache_t const *) ROM_CACHE_ADDRESS(slot))
+
+// Signature of the ROMs in the table, tells whether the table has changed
+static uint32_t ulRomSignature( hal_ds18b20_table_t const * sensors )
+{
+    uint32_t signature = sensors->count;
+
+    for(uint32_t i = 0; i < sensors->count; i++)
+    {
+        signature = signature * 31 + (uint32_t)(sensors->rom[i].qw ^ (sensors->rom[i].qw >> 32));
+    }
+
+    return signature;
+}
+
+// Save the ROMs of the bus if they differ from the cached ones. Every rewrite
+// erases the page, so a flapping probe must not rewrite it every cycle: the
+// table must stay the same for TEMPERATURE_ROM_CACHE_STABLE cycles, the page
+// is rewritten at most once per TEMPERATURE_ROM_CACHE_PERIOD_MS and an empty
+// table, a bus that lost all its probes, is never saved. The image buffer and
+// the flash controller are shared by the buses, so the page is rewritten with
+// the scheduler suspended, the flash stalls the code fetch anyway
+static void vSaveRomCache( xTemperatureBus_t * temperature_bus )
+{
+    static hal_ds18b20_rom_cache_t xCache;
+    hal_ds18b20_table_t const * sensors = &temperature_bus->hal.sensors;
+    uint32_t address = ROM_CACHE_ADDRESS(temperature_bus->rom_cache_slot);
+    uint32_t signature = ulRomSignature(sensors);
+    result_t result = RESULT_OK;
+
+    configASSERT( sizeof(hal_ds18b20_rom_cache_t) <= DRV_FLASH_PAGE_SIZE );
+
+    if (signature != temperature_bus->rom_signature)
+    {
+        temperature_bus->rom_signature = signature;
+        temperature_bus->rom_stable = 0;
+    }
+    else if (temperature_bus->rom_stable < TEMPERATURE_ROM_CACHE_STABLE)
+    {
+        temperature_bus->rom_stable++;
+    }
+
+    if (temperature_bus->rom_stable < TEMPERATURE_ROM_CACHE_STABLE || !sensors->count ||
+        signature == temperature_bus->rom_cached)
+    {
+        return;
+    }
+
+    if (temperature_bus->is_rom_saved &&
+        xTaskGetTickCount() - temperature_bus->rom_saved_at < pdMS_TO_TICKS(TEMPERATURE_ROM_CACHE_PERIOD_MS))
+    {
+        return;
+    }
+
+    vTaskSuspendAll();
+    hal_ds18b20_fill_rom_cache(&temperature_bus->hal, &xCache);
+
+    BOOL is_changed = memcmp(&xCache, pxRomCache(temperature_bus->rom_cache_slot), sizeof(xCache)) != 0;
+    if (is_changed)
+    {
+        result = drv_flash_erase_page(address);
+        if (result == RESULT_OK)
+        {
+            result = drv_flash_write(address, &xCache, sizeof(xCache));
+        }
+    }
+    xTaskResumeAll();
+
+    // A failed write is retried after the period
+    if (result == RESULT_OK)
+    {
+        temperature_bus->rom_cached = signature;
+    }
+
+    if (is_changed)
+    {
+        temperature_bus->rom_saved_at = xTaskGetTickCount();
+        temperature_bus->is_rom_saved = TRUE;
+        DEBUG_PRINT("ROM cache saved: %d", result);
+    }
+}
+#endif
 
 // Function that implements the task being created.
 void vTaskCode( void * pvParameters )
@@ -41,34 +244,211 @@ void vTaskCode( void * pvParameters )
     }
 }
 
+// Queue the record without waiting. Both buses queue their samples, so the
+// high-water mark is updated in the critical section
+static void vQueueSample( xSampleRecord_t const * record )
+{
+    BaseType_t is_queued = xQueueSend(xSampleQueue, record, 0);
+
+    taskENTER_CRITICAL();
+    if (is_queued == pdPASS)
+    {
+        uxSampleQueueHighWater = MAX(uxSampleQueueHighWater, uxQueueMessagesWaiting(xSampleQueue));
+    }
+    else
+    {
+        ulSamplesDropped++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+// Queue the readings converted since the sweep start and the failed ones,
+// then the end of the sweep. The task is the only writer of the table, so
+// it is read directly
+static void vQueueSweep( xTemperatureBus_t * temperature_bus, uint64_t sweep_start )
+{
+    hal_ds18b20_table_t const * sensors = &temperature_bus->hal.sensors;
+    xSampleRecord_t record = {.bus = temperature_bus->number - 1};
+
+    for(uint32_t i = 0; i < sensors->count; i++)
+    {
+        if (sensors->timestamp[i] < sweep_start && sensors->value[i] != DS18B20_TEMPERATURE_INVALID)
+        {
+            continue;
+        }
+
+        record.index = hal_ds18b20_is_thermometer(&temperature_bus->hal, i) ? i : i | SAMPLE_PIO;
+        record.value = sensors->value[i];
+        record.time_ms = (uint32_t)(sensors->timestamp[i] / 1000);
+        vQueueSample(&record);
+    }
+
+    UBaseType_t stack_free = uxTaskGetStackHighWaterMark(NULL);
+
+    taskENTER_CRITICAL();
+    temperature_bus->stats = *drv_one_wire_get_stats(temperature_bus->bus);
+    temperature_bus->stack_free = stack_free;
+    taskEXIT_CRITICAL();
+
+    record.index = SAMPLE_SWEEP_END;
+    record.value = 0;
+    record.time_ms = (uint32_t)(sweep_start / 1000);
+    vQueueSample(&record);
+}
+
 // Function that implements the task being created.
 void vGetTemperatureTask( void * pvParameters )
 {
-    // The parameter value is expected to be 1 as 1 is passed in the
-    // pvParameters value in the call to xTaskCreateStatic().
-    configASSERT( ( uint32_t ) pvParameters == 1UL );
+    // The parameter is the bus the task reads
+    xTemperatureBus_t * temperature_bus = (xTemperatureBus_t *) pvParameters;
+    configASSERT( temperature_bus != NULL );
 
-    static volatile hal_ds18b20_cxt_t sensor_cxt[5];
-    result_t result = hal_ds18b20_init((hal_ds18b20_cxt_t *)sensor_cxt, ARRAY_SIZE(sensor_cxt));
+#if ONE_WIRE_STRONG_PULLUP
+    if (temperature_bus == &xTemperatureBus)
+    {
+        drv_one_wire_strong_pullup_init(temperature_bus->bus, GPIOB, 0);
+    }
+#endif
+#if TEMPERATURE_ROM_CACHE
+    hal_ds18b20_rom_cache_t const * rom_cache = pxRomCache(temperature_bus->rom_cache_slot);
+#else
+    hal_ds18b20_rom_cache_t const * rom_cache = 0;
+#endif
+    result_t result = hal_ds18b20_init(&temperature_bus->hal, temperature_bus->bus, rom_cache);
     DEBUG_PRINT("DS18B20 init result: %d", result);
+#if TEMPERATURE_ROM_CACHE
+    vSaveRomCache(temperature_bus);
+#endif
+    temperature_bus->hal.read_mode = DS18B20_READ_FAST;
+    temperature_bus->hal.max_period = TEMPERATURE_MAX_PERIOD;
+    temperature_bus->hal.slope = TEMPERATURE_SLOPE;
 
-    for( ;; )
+#if TEMPERATURE_ALARM_MONITOR
+    hal_ds18b20_table_t const * sensors = &temperature_bus->hal.sensors;
+
+    for(uint32_t i = 0; i < sensors->count; i++)
     {
-        vTaskDelay(pdMS_TO_TICKS(5 *  1000));   //5 min
+        hal_ds18b20_set_alarm(&temperature_bus->hal, &temperature_bus->hal.sensors.rom[i],
+            TEMPERATURE_ALARM_HIGH, TEMPERATURE_ALARM_LOW, FALSE);
+    }
 
-        hal_ds18b20_read_all_temperatures();
+    uint32_t cycle = 0;
+#endif
+
+    // Cycles start on a fixed grid, however long the sweep of the cycle is
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    for( ;; )
+    {
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(TEMPERATURE_SWEEP_PERIOD_MS));
+        uint64_t sweep_start = hal_ds18b20_get_timestamp();
 
-        PRINT("Temp:");
-        for(uint8_t i = 0; i < ARRAY_SIZE(sensor_cxt), sensor_cxt[i].rom.qw; i++)
+#if TEMPERATURE_ALARM_MONITOR
+        if (cycle++ % TEMPERATURE_FULL_SWEEP_PERIOD)
         {
-            PRINT("\t%d. %+.3f; ", i+1, sensor_cxt[i].temperature);
+            uint32_t alarms;
+
+            hal_ds18b20_monitor(&temperature_bus->hal, &alarms);
+            DEBUG_PRINT("Sensors in alarm: %lu", alarms);
         }
-        PRINT("\r\n");
+        else
+#endif
+        hal_ds18b20_read_all_temperatures(&temperature_bus->hal);
+        hal_ds18b20_publish(&temperature_bus->hal, &temperature_bus->snapshot);
+        vQueueSweep(temperature_bus, sweep_start);
+
+        hal_ds18b20_rescan(&temperature_bus->hal, TEMPERATURE_RESCAN_STEPS);
+#if TEMPERATURE_ROM_CACHE
+        vSaveRomCache(temperature_bus);
+#endif
 
         //DEBUG_PRINT("HELLO! temp: %.2f\r\n", temp);
     }
 }
 
+// Send the line to the transport task
+static void vSendLine( uint8_t const * line, int32_t len )
+{
+    xStreamBufferSend(xTextStream, line, len, portMAX_DELAY);
+    xTextStreamHighWater = MAX(xTextStreamHighWater, xStreamBufferBytesAvailable(xTextStream));
+}
+
+// Function that implements the task being created. Formats the records of
+// the readings as lines of text, at the end of the sweep the statistics of
+// the bus and the pipeline
+void vFormatTask( void * pvParameters )
+{
+    xSampleRecord_t record;
+    uint8_t line[128];
+
+    for( ;; )
+    {
+        int32_t len;
+
+        xQueueReceive(xSampleQueue, &record, portMAX_DELAY);
+
+        xTemperatureBus_t * temperature_bus = pxTemperatureBuses[record.bus];
+        uint32_t i = record.index & ~SAMPLE_PIO;
+
+        if (record.index != SAMPLE_SWEEP_END)
+        {
+            if (!(record.index & SAMPLE_PIO))
+            {
+                uint8_t temperature[DS18B20_TEMPERATURE_STR_SIZE];
+
+                hal_ds18b20_format_temperature(record.value, temperature);
+                len = mini_snprintf(line, sizeof(line), (uint8_t *)"%lu.%lu. %s; %lu ms\r\n",
+                    temperature_bus->number, i + 1UL, temperature, record.time_ms);
+            }
+            else
+            {
+                len = mini_snprintf(line, sizeof(line), (uint8_t *)"%lu.%lu. PIO 0x%x; %lu ms\r\n",
+                    temperature_bus->number, i + 1UL, record.value, record.time_ms);
+            }
+            vSendLine(line, len);
+            continue;
+        }
+
+        xDrvOneWireStats_t stats;
+        UBaseType_t stack_free;
+
+        taskENTER_CRITICAL();
+        stats = temperature_bus->stats;
+        stack_free = temperature_bus->stack_free;
+        taskEXIT_CRITICAL();
+
+        len = mini_snprintf(line, sizeof(line),
+            (uint8_t *)"%lu. 1-Wire: presence failures %lu, timeouts %lu, framing errors %lu, worst %lu us\r\n",
+            temperature_bus->number, stats.presence_failures, stats.slot_timeouts,
+            stats.framing_errors, stats.worst_transaction_us);
+        vSendLine(line, len);
+
+        len = mini_snprintf(line, sizeof(line), (uint8_t *)"%lu. Stack: free %lu/%lu words\r\n",
+            temperature_bus->number, (uint32_t)stack_free, (uint32_t)TEMPERATURE_STACK_SIZE);
+        vSendLine(line, len);
+
+        len = mini_snprintf(line, sizeof(line),
+            (uint8_t *)"Pipeline: samples %lu/%lu, dropped %lu, text %lu/%lu bytes\r\n",
+            (uint32_t)uxSampleQueueHighWater, (uint32_t)TEMPERATURE_SAMPLE_QUEUE_LENGTH, ulSamplesDropped,
+            (uint32_t)xTextStreamHighWater, (uint32_t)TEMPERATURE_TEXT_BUFFER_SIZE);
+        vSendLine(line, len);
+    }
+}
+
+// Function that implements the task being created. The only task writing
+// to the UART, the other stages never wait for it
+void vTransportTask( void * pvParameters )
+{
+    uint8_t chunk[32];
+
+    for( ;; )
+    {
+        size_t len = xStreamBufferReceive(xTextStream, chunk, sizeof(chunk), portMAX_DELAY);
+
+        drv_usart_puts(DU_USART1, chunk, len);
+    }
+}
+
 /* configSUPPORT_STATIC_ALLOCATION is set to 1, so the application must provide an
 implementation of vApplicationGetIdleTaskMemory() to provide the memory that is
 used by the Idle task. */
@@ -96,6 +476,19 @@ static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
 }
 /*———————————————————–*/
 
+/* configCHECK_FOR_STACK_OVERFLOW is set, the kernel calls the hook on the
+context switch that finds the stack of the task overflowed. The neighbouring
+statics may be corrupted already, so stop here for the debugger. */
+void vApplicationStackOverflowHook( TaskHandle_t xTask, char *pcTaskName )
+{
+    ( void ) xTask;
+    ( void ) pcTaskName;
+
+    taskDISABLE_INTERRUPTS();
+    for( ;; );
+}
+/*———————————————————–*/
+
 
 int main(void)
 {
@@ -105,10 +498,20 @@ int main(void)
     GPIOC->CRH 	|= GPIO_CRH_MODE13_0;	// Выставляем бит MODE0 для пятого пина. Режим MODE01 = Max Speed 10MHz
 
     drv_clocks_init_sysclk();
+    drv_dwt_init();                     //1-Wire deadlines and transaction times
 
     xDrvUsartPortParams_t usart1_params = {DU_USART1, DU_DATA_BITS_8, DU_STOP_BITS_1, DU_NO_PARITY, 115200};
     drv_usart_init_port(&usart1_params);
 
+#if ONE_WIRE_BENCHMARK && ONE_WIRE_BUS_BACKEND == ONE_WIRE_BACKEND_USART
+    drv_one_wire_usart_benchmark(&xOneWireUsart);
+#endif
+
+    xSampleQueue = xQueueCreateStatic(TEMPERATURE_SAMPLE_QUEUE_LENGTH, sizeof(xSampleRecord_t),
+                    ucSampleQueueStorage, &xSampleQueueBuffer);
+    xTextStream = xStreamBufferCreateStatic(TEMPERATURE_TEXT_BUFFER_SIZE, 1,
+                    ucTextStreamStorage, &xTextStreamBuffer);
+
     TaskHandle_t xHandle = NULL;
 
     // Create the task without using any dynamic memory allocation.
@@ -124,12 +527,42 @@ int main(void)
     xTaskCreateStatic(
                     vGetTemperatureTask,       // Function that implements the task.
                     "TEMP",          // Text name for the task.
-                    STACK_SIZE,      // Stack size in words, not bytes.
-                    ( void * ) 1,    // Parameter passed into the task.
+                    TEMPERATURE_STACK_SIZE, // Stack size in words, not bytes.
+                    &xTemperatureBus,    // Parameter passed into the task.
                     2,               // Priority at which the task is created.
                     xGetTemperatureTaskStack,          // Array to use as the task's stack.
                     &xGetTemperatureTaskBuffer );  // Variable to hold the task's data structure.
 
+    // Formats the sweeps below the acquisition, so it never delays the bus
+    xTaskCreateStatic(
+                    vFormatTask,     // Function that implements the task.
+                    "FMT",           // Text name for the task.
+                    STACK_SIZE,      // Stack size in words, not bytes.
+                    NULL,            // Parameter passed into the task.
+                    1,               // Priority at which the task is created.
+                    xFormatTaskStack,          // Array to use as the task's stack.
+                    &xFormatTaskBuffer );  // Variable to hold the task's data structure.
+
+    xTaskCreateStatic(
+                    vTransportTask,  // Function that implements the task.
+                    "UART",          // Text name for the task.
+                    STACK_SIZE,      // Stack size in words, not bytes.
+                    NULL,            // Parameter passed into the task.
+                    1,               // Priority at which the task is created.
+                    xTransportTaskStack,       // Array to use as the task's stack.
+                    &xTransportTaskBuffer );  // Variable to hold the task's data structure.
+
+#if ONE_WIRE_SECOND_BUS
+    xTaskCreateStatic(
+                    vGetTemperatureTask,       // Function that implements the task.
+                    "TEMP2",         // Text name for the task.
+                    TEMPERATURE_STACK_SIZE, // Stack size in words, not bytes.
+                    &xTemperatureBus2,   // Parameter passed into the task.
+                    2,               // Priority at which the task is created.
+                    xGetTemperatureTask2Stack,         // Array to use as the task's stack.
+                    &xGetTemperatureTask2Buffer ); // Variable to hold the task's data structure.
+#endif
+
     // Start the scheduler.
     vTaskStartScheduler();
 
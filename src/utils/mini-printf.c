@@ -45,6 +45,7 @@
 #include "drv_usart.h"
 #include "math.h"
 #include "macro.h"
+#include "config.h"
 
 //TODO: Need to check this function
 static int32_t mini_putc(uint8_t * const ptr, const uint8_t ch)
@@ -122,6 +123,7 @@ static uint32_t mini_itoa(int32_t value, uint32_t radix, uint32_t uppercase, uin
 }
 
 
+#if PRINTF_FLOAT
 static uint32_t mini_ftoa(float value, uint32_t uppercase, uint8_t *buffer, uint32_t width, uint32_t precision, uint8_t is_zero_pad, uint32_t force_sign)
 {
     uint8_t    *pbuffer = buffer;
@@ -190,6 +192,7 @@ static uint32_t mini_ftoa(float value, uint32_t uppercase, uint8_t *buffer, uint
 
     return len;
 }
+#endif
 
 struct mini_buff {
     uint8_t *buffer, *pbuffer;
@@ -340,6 +343,7 @@ int32_t mini_printf(const uint8_t *fmt, ...)
                     drv_usart_puts(DU_USART1, ptr, mini_strlen(ptr));
                     break;
 
+#if PRINTF_FLOAT
                 case 'f' :
                 case 'F' :
                     len = mini_ftoa(va_arg(arglist, double), (ch=='F'), bf, width, precision, is_zero_pad, is_force_positive);
@@ -351,6 +355,17 @@ int32_t mini_printf(const uint8_t *fmt, ...)
                     len = mini_ftoa(va_arg(arglist, double), (ch=='E'), bf, width, precision, is_zero_pad, is_force_positive);
                     drv_usart_puts(DU_USART1, bf, len);
                     break;
+#else
+                case 'f' :
+                case 'F' :
+                case 'e' :
+                case 'E' :
+                    // Skip the argument without touching floating point
+                    va_arg(arglist, double);
+                    drv_usart_putc(DU_USART1, '?');
+                    (void)is_zero_pad;
+                    break;
+#endif
 
                 default:
                     drv_usart_putc(DU_USART1, ch);
@@ -513,6 +528,7 @@ int32_t mini_vsnprintf(uint8_t *buffer, uint32_t buffer_len, const uint8_t *fmt,
                     buffer += mini_strlen(ptr);
                     break;
 
+#if PRINTF_FLOAT
                 case 'f' :
                 case 'F' :
                     len = mini_ftoa(va_arg(va, double), (ch=='F'), bf, width, precision, is_zero_pad, is_force_positive);
@@ -526,6 +542,17 @@ int32_t mini_vsnprintf(uint8_t *buffer, uint32_t buffer_len, const uint8_t *fmt,
                     mini_puts(bf, len, buffer);
                     buffer += len;
                     break;
+#else
+                case 'f' :
+                case 'F' :
+                case 'e' :
+                case 'E' :
+                    // Skip the argument without touching floating point
+                    va_arg(va, double);
+                    mini_putc(buffer++, '?');
+                    (void)is_zero_pad;
+                    break;
+#endif
 
                 default:
                     mini_putc(buffer++,ch);
@@ -0,0 +1,41 @@
+/**
+ * @file host.h
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Host build of the drivers: stand-ins for the scheduler, the cycle
+ *      counter and the clocks, and the check macro of the tests
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#ifndef _HOST_H_
+#define _HOST_H_
+
+#include <stdio.h>
+
+#include "types.h"
+#include "macro.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// The drivers yield from their interrupt handlers by writing the SCB
+#undef portYIELD_FROM_ISR
+#define portYIELD_FROM_ISR(x)       (void)(x)
+
+#define CHECK(x)    do { if (!(x)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); host_failures++; } } while (0)
+
+extern uint32_t host_failures;
+
+// Returned by xTaskGetSchedulerState(), taskSCHEDULER_NOT_STARTED by default
+extern BaseType_t host_scheduler_state;
+
+// Time of the host model, us. Every deadline check moves it by 1 us
+extern uint32_t host_time_us;
+
+// Called by ulTaskNotifyTake() to run the models of the peripherals until
+// they notify the task or stop, 0 if nothing runs
+extern void (*host_run_hardware)(void);
+
+#endif  //_HOST_H_
\ No newline at end of file
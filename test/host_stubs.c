@@ -0,0 +1,98 @@
+/**
+ * @file host_stubs.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Host build of the drivers: stand-ins for the scheduler, the cycle
+ *      counter and the clocks
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "host.h"
+#include "drv_dwt.h"
+#include "drv_clocks.h"
+
+uint32_t host_failures;
+BaseType_t host_scheduler_state = taskSCHEDULER_NOT_STARTED;
+uint32_t host_time_us;
+void (*host_run_hardware)(void);
+
+static UBaseType_t _notifications;
+
+uint32_t drv_dwt_get_cycles(void)
+{
+    return host_time_us * (configCPU_CLOCK_HZ / 1000000UL);
+}
+
+uint32_t drv_dwt_get_deadline(uint32_t us)
+{
+    return host_time_us + us;
+}
+
+BOOL drv_dwt_is_expired(uint32_t deadline)
+{
+    return (int32_t)(host_time_us++ - deadline) >= 0;
+}
+
+uint32_t drv_dwt_cycles_to_us(uint32_t cycles)
+{
+    return cycles / (configCPU_CLOCK_HZ / 1000000UL);
+}
+
+void drv_dwt_delay_us(uint32_t us)
+{
+    host_time_us += us;
+}
+
+uint32_t drv_clocks_get_timxclk(uint32_t timer_no)
+{
+    (void)timer_no;
+
+    return configCPU_CLOCK_HZ;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    return host_scheduler_state;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t) &_notifications;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    host_time_us += xTicksToDelay * (1000000UL / configTICK_RATE_HZ);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    UBaseType_t notifications;
+
+    if (!_notifications && xTicksToWait && host_run_hardware)
+    {
+        host_run_hardware();
+    }
+
+    notifications = _notifications;
+    if (xClearCountOnExit)
+    {
+        _notifications = 0;
+    }
+    else if (_notifications)
+    {
+        _notifications--;
+    }
+
+    return notifications;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t * pxHigherPriorityTaskWoken)
+{
+    (void)xTaskToNotify;
+
+    _notifications++;
+    *pxHigherPriorityTaskWoken = pdTRUE;
+}
\ No newline at end of file
@@ -0,0 +1,537 @@
+/**
+ * @file test_one_wire_parallel.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Host test of the parallel 1-wire master. TIM1, the DMA requests and
+ *      the port are replaced with a waveform simulator: every slot the words
+ *      DMA would write to BSRR are applied at the compare times programmed to
+ *      TIM1, the devices on every bus answer and check the timing, and IDR is
+ *      sampled at the sample compare time
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "host.h"
+#include "stm32f103xb.h"
+
+#include <string.h>
+
+static TIM_TypeDef _tim1;
+static RCC_TypeDef _rcc;
+static GPIO_TypeDef _port;
+static GPIO_TypeDef _pullup_port;
+
+#undef TIM1
+#define TIM1                    (&_tim1)
+#undef RCC
+#define RCC                     (&_rcc)
+
+#include "drv_one_wire_parallel.c"
+
+#define SIM_NEVER               0xFFFF
+
+// 1-Wire standard speed limits, us
+#define SIM_RESET_LOW_MIN       480
+#define SIM_RESET_HIGH_MIN      480
+#define SIM_PRESENCE_WAIT       30
+#define SIM_PRESENCE_LOW        120
+#define SIM_WRITE_1_LOW_MAX     15
+#define SIM_WRITE_0_LOW_MIN     60
+#define SIM_WRITE_0_LOW_MAX     120
+#define SIM_READ_SAMPLE_MAX     15
+#define SIM_DEVICE_SAMPLE       30      //Device samples written bits and holds read 0 till then
+#define SIM_RECOVERY_MIN        1
+
+#define SIM_MAX_BITS            (32 * 8)
+
+// Device on one bus: it answers with the reply bits while it has them and
+// records the written bits otherwise
+typedef struct
+{
+    BOOL is_present;
+    uint8_t reply[32];
+    uint16_t reply_bits;
+    uint16_t reply_position;
+    uint16_t reply_after;           //Written bits before the device answers
+    uint8_t received[32];
+    uint16_t received_bits;
+    uint16_t resets;
+} xSimDevice_t;
+
+static xSimDevice_t _devices[ONE_WIRE_PARALLEL_BUS_NUM];
+static xDrvDmaTransfer_t _dma[DD_CHANNEL_NUM];
+static BOOL _is_run;
+static uint32_t _timing_errors;
+static uint32_t _slots;
+
+/**
+ * @brief Reset the simulator and the devices
+ * 
+ * @param present Mask of the buses with a device
+ */
+static void _sim_reset(uint16_t present)
+{
+    memset(_devices, 0, sizeof(_devices));
+    memset(&_port, 0, sizeof(_port));
+    _timing_errors = 0;
+    _slots = 0;
+
+    for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+    {
+        _devices[pin].is_present = (present >> pin) & 0x01;
+    }
+}
+
+/**
+ * @brief Give the device bytes to answer in the read slots that follow the
+ *      given amount of written bits
+ * 
+ * @param pin The bus of the device
+ * @param data The bytes
+ * @param length The amount of bytes
+ * @param after The amount of bits the device receives before it answers
+ */
+static void _sim_reply(uint8_t pin, uint8_t const * data, uint8_t length, uint16_t after)
+{
+    memcpy(_devices[pin].reply, data, length);
+    _devices[pin].reply_bits = length * 8;
+    _devices[pin].reply_position = 0;
+    _devices[pin].reply_after = _devices[pin].received_bits + after;
+}
+
+/**
+ * @brief Get the bit of LSB first bit string
+ * 
+ * @param data The bit string
+ * @param position The bit number
+ * @return uint8_t The bit
+ */
+static uint8_t _bit(uint8_t const * data, uint16_t position)
+{
+    return (data[position / 8] >> (position % 8)) & 0x01;
+}
+
+/**
+ * @brief Run one slot on one bus and get the line state at the sample time
+ * 
+ * @param device The device of the bus
+ * @param rise The time the master releases the line, us from the slot start
+ * @param sample The sample time
+ * @param period The slot length
+ * @return uint8_t The line state at the sample time
+ */
+static uint8_t _sim_slot(xSimDevice_t * device, uint16_t rise, uint16_t sample, uint16_t period)
+{
+    uint16_t hold_from = SIM_NEVER;
+    uint16_t hold_to = 0;
+
+    if (rise >= SIM_RESET_LOW_MIN)
+    {
+        if (period - rise < SIM_RESET_HIGH_MIN)
+        {
+            _timing_errors++;
+        }
+
+        if (device->is_present)
+        {
+            hold_from = rise + SIM_PRESENCE_WAIT;
+            hold_to = hold_from + SIM_PRESENCE_LOW;
+            device->resets++;
+        }
+    }
+    else if (device->is_present && device->received_bits >= device->reply_after &&
+        device->reply_position < device->reply_bits)
+    {
+        // Read slot, the device holds the line for 0
+        if (rise > SIM_READ_SAMPLE_MAX || sample > SIM_READ_SAMPLE_MAX || sample < rise)
+        {
+            _timing_errors++;
+        }
+
+        if (!_bit(device->reply, device->reply_position++))
+        {
+            hold_from = 0;
+            hold_to = SIM_DEVICE_SAMPLE;
+        }
+    }
+    else
+    {
+        // Write slot, the device samples the line
+        if (!(rise <= SIM_WRITE_1_LOW_MAX || (rise >= SIM_WRITE_0_LOW_MIN && rise <= SIM_WRITE_0_LOW_MAX)))
+        {
+            _timing_errors++;
+        }
+
+        if (device->is_present && device->received_bits < SIM_MAX_BITS)
+        {
+            if (rise <= SIM_DEVICE_SAMPLE)
+            {
+                device->received[device->received_bits / 8] |= 1 << (device->received_bits % 8);
+            }
+            device->received_bits++;
+        }
+    }
+
+    if (period < MAX(rise, hold_to) + SIM_RECOVERY_MIN)
+    {
+        _timing_errors++;
+    }
+
+    return (sample >= rise && !(sample >= hold_from && sample < hold_to)) ? 1 : 0;
+}
+
+/**
+ * @brief Run all slots of the started DMA transfers with the compare times
+ *      programmed to TIM1: pull word at the update, release word at CC1,
+ *      IDR sample at CC2, release all word at CC4
+ */
+static void _sim_run(void)
+{
+    xDrvDmaTransfer_t * pull = &_dma[PAR_DMA_PULL];
+    xDrvDmaTransfer_t * release = &_dma[PAR_DMA_RELEASE];
+    xDrvDmaTransfer_t * sample = &_dma[PAR_DMA_SAMPLE];
+    xDrvDmaTransfer_t * release_all = &_dma[PAR_DMA_RELEASE_ALL];
+    uint16_t period = _tim1.ARR + 1;
+
+    CHECK(pull->count == release->count && pull->count == sample->count && pull->count == release_all->count);
+    CHECK(pull->periph_addr == &_port.BSRR && release->periph_addr == &_port.BSRR && release_all->periph_addr == &_port.BSRR);
+    CHECK(sample->periph_addr == &_port.IDR);
+    CHECK(_tim1.CCR1 < _tim1.CCR2 && _tim1.CCR2 < _tim1.CCR4 && _tim1.CCR4 < period);
+
+    for (uint16_t slot = 0; slot < pull->count; slot++)
+    {
+        uint32_t pull_word = *(uint32_t volatile *)pull->mem_addr;
+        uint32_t release_word = ((uint32_t volatile *)release->mem_addr)[release->mem_increment ? slot : 0];
+        uint32_t release_all_word = *(uint32_t volatile *)release_all->mem_addr;
+        uint16_t idr = 0xFFFF;
+
+        for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+        {
+            uint16_t rise = SIM_NEVER;
+
+            if (!((pull_word >> 16) & (1 << pin)))
+            {
+                continue;
+            }
+
+            if (release_word & (1 << pin))
+            {
+                rise = _tim1.CCR1;
+            }
+            else if (release_all_word & (1 << pin))
+            {
+                rise = _tim1.CCR4;
+            }
+
+            if (!_sim_slot(&_devices[pin], rise, _tim1.CCR2, period))
+            {
+                idr &= ~(1 << pin);
+            }
+        }
+
+        ((uint16_t volatile *)sample->mem_addr)[slot] = idr;
+        _slots++;
+    }
+
+    host_time_us += pull->count * period;
+}
+
+result_t drv_dma_start(eDrvDmaChannel_t channel, xDrvDmaTransfer_t * transfer)
+{
+    _dma[channel] = *transfer;
+    _is_run = FALSE;
+
+    return RESULT_OK;
+}
+
+void drv_dma_stop(eDrvDmaChannel_t channel)
+{
+    (void)channel;
+}
+
+BOOL drv_dma_is_complete(eDrvDmaChannel_t channel)
+{
+    if (!_is_run)
+    {
+        _sim_run();
+        _is_run = TRUE;
+    }
+
+    return TRUE;
+}
+
+uint16_t drv_dma_get_remaining(eDrvDmaChannel_t channel)
+{
+    (void)channel;
+
+    return 0;
+}
+
+/**
+ * @brief Release words carry the bits of every bus in its own pin and
+ *      nothing of the buses out of the mask
+ */
+static void _test_build_release(void)
+{
+    xDrvOneWireParallelData_t data[2];
+    uint32_t release[2 * 8];
+    uint16_t pins = (1 << 0) | (1 << 5) | (1 << 15);
+
+    memset(data, 0xFF, sizeof(data));
+    data[0][0] = 0x01;
+    data[0][5] = 0x80;
+    data[0][15] = 0x55;
+    data[1][0] = 0x00;
+    data[1][5] = 0xFF;
+    data[1][15] = 0xAA;
+
+    drv_one_wire_parallel_build_release(pins, data, 2, release);
+
+    for (uint8_t byte = 0; byte < 2; byte++)
+    {
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            uint32_t expected = 0;
+
+            for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+            {
+                if ((pins & (1 << pin)) && ((data[byte][pin] >> bit) & 0x01))
+                {
+                    expected |= 1 << pin;
+                }
+            }
+
+            CHECK(release[byte * 8 + bit] == expected);
+            CHECK(!(release[byte * 8 + bit] & ~(uint32_t)pins));
+        }
+    }
+
+    CHECK(release[0] == ((1 << 0) | (1 << 15)));
+    CHECK(release[7] == (1 << 5));
+}
+
+/**
+ * @brief Sampled IDR words are unpacked LSB first into the bytes of the
+ *      buses of the mask, the other bytes are kept
+ */
+static void _test_unpack(void)
+{
+    xDrvOneWireParallelData_t data[2];
+    uint16_t samples[2 * 8];
+    uint16_t pins = (1 << 2) | (1 << 9);
+
+    memset(data, 0xA5, sizeof(data));
+    for (uint8_t i = 0; i < ARRAY_SIZE(samples); i++)
+    {
+        // Bus 2 reads 0x0F 0xF0, bus 9 reads 0x81 0x18, the rest is noise
+        samples[i] = 0x5000;
+        samples[i] |= ((i < 8 ? 0x0F : 0xF0) >> (i % 8)) & 0x01 ? 1 << 2 : 0;
+        samples[i] |= ((i < 8 ? 0x81 : 0x18) >> (i % 8)) & 0x01 ? 1 << 9 : 0;
+    }
+
+    drv_one_wire_parallel_unpack(pins, samples, 2, data);
+
+    CHECK(data[0][2] == 0x0F && data[1][2] == 0xF0);
+    CHECK(data[0][9] == 0x81 && data[1][9] == 0x18);
+    CHECK(data[0][12] == 0xA5 && data[1][14] == 0xA5 && data[0][0] == 0xA5);
+}
+
+/**
+ * @brief Reset pulse on several buses at once reports presence of every bus
+ *      separately
+ */
+static void _test_reset(void)
+{
+    xDrvOneWireParallel_t parallel = {.port = &_port, .pins = 0x00FF};
+
+    _sim_reset((1 << 1) | (1 << 3) | (1 << 12));
+
+    CHECK(drv_one_wire_parallel_reset(&parallel, (1 << 1) | (1 << 2) | (1 << 3) | (1 << 12)) == ((1 << 1) | (1 << 3)));
+    CHECK(_devices[1].resets == 1 && _devices[3].resets == 1);
+    CHECK(_devices[12].resets == 0);
+    CHECK(_timing_errors == 0);
+}
+
+/**
+ * @brief Every bus gets its own bytes in the same slots, then every device
+ *      answers its own bytes. More bytes than one run takes go in chunks
+ */
+static void _test_write_read(void)
+{
+    xDrvOneWireParallel_t parallel = {.port = &_port, .pins = 0xFFFF};
+    uint16_t pins = (1 << 0) | (1 << 7) | (1 << 13);
+    uint8_t const length = ONE_WIRE_PARALLEL_MAX_BYTES + 3;
+    xDrvOneWireParallelData_t data[ONE_WIRE_PARALLEL_MAX_BYTES + 3];
+    uint8_t reply[ONE_WIRE_PARALLEL_MAX_BYTES + 3];
+
+    _sim_reset(pins);
+
+    for (uint8_t byte = 0; byte < length; byte++)
+    {
+        for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+        {
+            data[byte][pin] = (uint8_t)(byte * 31 + pin * 7);
+        }
+    }
+
+    CHECK(drv_one_wire_parallel_touch(&parallel, pins, data, length) == RESULT_OK);
+    CHECK(_slots == length * 8);
+
+    for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+    {
+        if (!(pins & (1 << pin)))
+        {
+            continue;
+        }
+
+        CHECK(_devices[pin].received_bits == length * 8);
+        for (uint8_t byte = 0; byte < length; byte++)
+        {
+            CHECK(_devices[pin].received[byte] == (uint8_t)(byte * 31 + pin * 7));
+        }
+
+        for (uint8_t byte = 0; byte < length; byte++)
+        {
+            reply[byte] = (uint8_t)(0xC3 ^ (byte * 13) ^ pin);
+        }
+        _sim_reply(pin, reply, length, 0);
+    }
+
+    memset(data, 0xFF, sizeof(data));
+    CHECK(drv_one_wire_parallel_touch(&parallel, pins, data, length) == RESULT_OK);
+
+    for (uint8_t pin = 0; pin < ONE_WIRE_PARALLEL_BUS_NUM; pin++)
+    {
+        for (uint8_t byte = 0; byte < length; byte++)
+        {
+            uint8_t expected = (pins & (1 << pin)) ? (uint8_t)(0xC3 ^ (byte * 13) ^ pin) : 0xFF;
+
+            CHECK(data[byte][pin] == expected);
+        }
+    }
+
+    CHECK(_timing_errors == 0);
+}
+
+/**
+ * @brief One bus of the parallel master works as a common bus: reset,
+ *      Match ROM header and read through the transaction cursor
+ */
+static void _test_bus_transaction(void)
+{
+    xDrvOneWireParallel_t parallel = {.port = &_port, .pins = 0xFFFF};
+    xDrvOneWireParallelPin_t pin = {.parallel = &parallel, .pin = 4};
+    xDrvOneWireBus_t bus = {.ops = &drv_one_wire_parallel_ops, .hw = &pin};
+    uint8_t const rom[ONE_WIRE_ROM_SIZE] = {0x28, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    uint8_t const scratch[9] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x1C};
+    uint8_t rx[9];
+
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = 0x55,
+        .rom = rom,
+        .command = 0xBE,
+        .rx = rx,
+        .rx_length = sizeof(rx)
+    };
+
+    _sim_reset(1 << 4);
+    _sim_reply(4, scratch, sizeof(scratch), ONE_WIRE_HEADER_MAX * 8);
+    CHECK(drv_one_wire_transaction(&bus, &transaction) == RESULT_OK);
+    CHECK(_devices[4].resets == 1 && _devices[4].received_bits == ONE_WIRE_HEADER_MAX * 8);
+    CHECK(_devices[4].received[0] == 0x55 && !memcmp(&_devices[4].received[1], rom, sizeof(rom)));
+    CHECK(_devices[4].received[1 + ONE_WIRE_ROM_SIZE] == 0xBE);
+    CHECK(!memcmp(rx, scratch, sizeof(scratch)));
+    CHECK(_timing_errors == 0);
+
+    _sim_reset(0);
+    CHECK(drv_one_wire_transaction(&bus, &transaction) == RESULT_NO_DEVICE);
+}
+
+/**
+ * @brief Chained transactions and a script of them run back to back: the
+ *      device sees both resets and the whole write stream in order, the
+ *      strong pull-up of the last one is enabled after its last slot
+ */
+static void _test_chain(void)
+{
+    xDrvOneWireParallel_t parallel = {.port = &_port, .pins = 0xFFFF};
+    xDrvOneWireParallelPin_t pin = {.parallel = &parallel, .pin = 2};
+    xDrvOneWireBus_t bus = {.ops = &drv_one_wire_parallel_ops, .hw = &pin};
+    uint8_t const convert[] = {0xCC, 0x44};
+    uint8_t const read[] = {0xCC, 0xBE};
+    uint8_t const scratch[9] = {0x91, 0x01, 0x4B, 0x46, 0x7F, 0xFF, 0x0F, 0x10, 0x8D};
+    uint8_t rx[9];
+    xDrvOneWirePullup_t const pullup = {.port = &_pullup_port, .pin = 3};
+
+    xDrvOneWireTransaction_t second = {
+        .is_reset = TRUE,
+        .rom_command = 0xCC,
+        .command = 0xBE,
+        .rx = rx,
+        .rx_length = sizeof(rx),
+        .pullup = &pullup
+    };
+
+    xDrvOneWireTransaction_t first = {
+        .is_reset = TRUE,
+        .rom_command = 0xCC,
+        .command = 0x44,
+        .rx_length = 0,
+        .next = &second
+    };
+
+    CHECK(drv_one_wire_get_timeout_ms(&first) == 2 * ONE_WIRE_TRANSACTION_TIMEOUT_MS);
+
+    _sim_reset(1 << 2);
+    _sim_reply(2, scratch, sizeof(scratch), 4 * 8);
+    CHECK(drv_one_wire_transaction(&bus, &first) == RESULT_OK);
+    CHECK(_pullup_port.BSRR == 1UL << (3 + 16));
+    CHECK(_devices[2].resets == 2 && _devices[2].received_bits == 4 * 8);
+    CHECK(!memcmp(_devices[2].received, convert, sizeof(convert)));
+    CHECK(!memcmp(&_devices[2].received[2], read, sizeof(read)));
+    CHECK(!memcmp(rx, scratch, sizeof(scratch)));
+    CHECK(_timing_errors == 0);
+
+    xDrvOneWireStep_t const steps[] = {
+        {.type = DOW_STEP_RESET},
+        {.type = DOW_STEP_WRITE, .tx = convert, .length = sizeof(convert)},
+        {.type = DOW_STEP_RESET},
+        {.type = DOW_STEP_WRITE, .tx = read, .length = sizeof(read)},
+        {.type = DOW_STEP_READ, .rx = rx, .length = sizeof(rx)}
+    };
+
+    memset(rx, 0, sizeof(rx));
+    _sim_reset(1 << 2);
+    _sim_reply(2, scratch, sizeof(scratch), 4 * 8);
+    CHECK(drv_one_wire_script(&bus, steps, sizeof(steps) / sizeof(steps[0])) == RESULT_OK);
+    CHECK(_devices[2].resets == 2 && _devices[2].received_bits == 4 * 8);
+    CHECK(!memcmp(rx, scratch, sizeof(scratch)));
+    CHECK(_timing_errors == 0);
+
+    // Nobody answers the reset: the chain stops at the first transaction
+    // and the line is not powered
+    _sim_reset(0);
+    _pullup_port.BSRR = 0;
+    CHECK(drv_one_wire_transaction(&bus, &first) == RESULT_NO_DEVICE);
+    CHECK(_pullup_port.BSRR == 0);
+}
+
+int main(void)
+{
+    _test_build_release();
+    _test_unpack();
+    _test_reset();
+    _test_write_read();
+    _test_bus_transaction();
+    _test_chain();
+
+    if (host_failures)
+    {
+        fprintf(stderr, "%u checks failed\n", host_failures);
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,525 @@
+/**
+ * @file test_one_wire_usart.c
+ * @author Alexey Nikolaev (alexeynikzzz@gmail.com)
+ * @brief Host test of the USART 1-wire backend. The port and DMA are replaced
+ *      with a model of the half-duplex line: every byte sent comes back as
+ *      its echo, shortened by the presence pulse after a reset pulse or
+ *      pulled low by the device in its read slots. Framing error can be
+ *      injected at any byte
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+#include "host.h"
+
+#include <string.h>
+
+#include "drv_one_wire_usart.c"
+
+#define SIM_NEVER               0xFFFF
+#define SIM_PRESENCE_ECHO       0xE0    //Reset pulse echo shortened by the presence pulse
+#define SIM_READ_0_ECHO         0xF8    //Read slot echo with the line held by the device
+#define SIM_TX_CHANNEL          DD_CHANNEL_7
+#define SIM_RX_CHANNEL          DD_CHANNEL_6
+
+// Device on the line: it answers with the reply bits while it has them and
+// records the written bits otherwise
+typedef struct
+{
+    BOOL is_present;
+    uint8_t reply[16];
+    uint16_t reply_bits;
+    uint16_t reply_position;
+    uint16_t reply_after;           //Written bits before the device answers
+    uint8_t received[32];
+    uint16_t received_bits;
+    uint16_t resets;
+} xSimDevice_t;
+
+static xSimDevice_t _device;
+static uint32_t _brr;
+static eDrvUsartStopBits_t _stop_bits;
+static uint32_t _baud_errors;
+static uint32_t _recovery_errors;
+static uint32_t _rx_errors;
+static uint16_t _bytes;
+static uint16_t _framing_error_at;
+static uint8_t _rx;
+static BOOL _is_rx;
+static BOOL _is_dma;
+static BOOL _is_stuck;
+static xDrvDmaTransfer_t _dma[DD_CHANNEL_NUM];
+static BOOL _is_dma_started[DD_CHANNEL_NUM];
+static uint16_t _dma_blocks;
+static uint16_t _waits;
+
+/**
+ * @brief Reset the model and the device
+ * 
+ * @param is_present TRUE if the device answers
+ */
+static void _sim_reset(BOOL is_present)
+{
+    memset(&_device, 0, sizeof(_device));
+    _device.is_present = is_present;
+    _baud_errors = 0;
+    _recovery_errors = 0;
+    _rx_errors = 0;
+    _bytes = 0;
+    _framing_error_at = SIM_NEVER;
+    _is_rx = FALSE;
+    _is_stuck = FALSE;
+    _dma_blocks = 0;
+    _waits = 0;
+}
+
+/**
+ * @brief Give the device bytes to answer in the read slots that follow the
+ *      given amount of written bits
+ * 
+ * @param data The bytes
+ * @param length The amount of bytes
+ * @param after The amount of bits the device receives before it answers
+ */
+static void _sim_reply(uint8_t const * data, uint8_t length, uint16_t after)
+{
+    memcpy(_device.reply, data, length);
+    _device.reply_bits = length * 8;
+    _device.reply_position = 0;
+    _device.reply_after = _device.received_bits + after;
+}
+
+/**
+ * @brief Get the bit of LSB first bit string
+ * 
+ * @param data The bit string
+ * @param position The bit number
+ * @return uint8_t The bit
+ */
+static uint8_t _bit(uint8_t const * data, uint16_t position)
+{
+    return (data[position / 8] >> (position % 8)) & 0x01;
+}
+
+/**
+ * @brief Send the byte to the line and get its echo. Reset pulse must go at
+ *      reset baudrate, time slots at slot baudrate, and overdrive slots need
+ *      two stop bits of recovery
+ * 
+ * @param ch The byte
+ * @return uint8_t The echo
+ */
+static uint8_t _sim_echo(uint8_t ch)
+{
+    uint8_t echo = ch;
+
+    if (_bytes++ == _framing_error_at)
+    {
+        // Line held low for the whole frame
+        _rx_errors |= USART_SR_FE;
+        return 0x00;
+    }
+
+    if (ch == ONE_WIRE_RESET_PULSE)
+    {
+        if (_brr != ONE_WIRE_RESET_BAUDRATE && _brr != ONE_WIRE_OD_RESET_BAUDRATE)
+        {
+            _baud_errors++;
+        }
+
+        if (_device.is_present)
+        {
+            _device.resets++;
+            echo = SIM_PRESENCE_ECHO;
+        }
+
+        return echo;
+    }
+
+    if (_brr != ONE_WIRE_SLOT_BAUDRATE && _brr != ONE_WIRE_OD_SLOT_BAUDRATE)
+    {
+        _baud_errors++;
+    }
+
+    // 0 slot at 1 Mbaud is low for 9 us, the stop bits are the 2 us recovery
+    if (_brr == ONE_WIRE_OD_SLOT_BAUDRATE && _stop_bits != DU_STOP_BITS_2)
+    {
+        _recovery_errors++;
+    }
+
+    if (!_device.is_present)
+    {
+        return echo;
+    }
+
+    if (_device.received_bits >= _device.reply_after && _device.reply_position < _device.reply_bits)
+    {
+        if (ch == ONE_WIRE_SLOT_ONE && !_bit(_device.reply, _device.reply_position))
+        {
+            echo = SIM_READ_0_ECHO;
+        }
+        _device.reply_position++;
+    }
+    else if (_device.received_bits < sizeof(_device.received) * 8)
+    {
+        if (ch == ONE_WIRE_SLOT_ONE)
+        {
+            _device.received[_device.received_bits / 8] |= 1 << (_device.received_bits % 8);
+        }
+        _device.received_bits++;
+    }
+
+    return echo;
+}
+
+/**
+ * @brief Run the started DMA transfers: Tx DMA sends the slot bytes and Rx
+ *      DMA stores their echoes, then the Rx callback runs as the interrupt
+ *      would and may start the next block. Called when the task sleeps
+ */
+static void _sim_dma(void)
+{
+    _waits++;
+
+    while (!_is_stuck && _is_dma && _is_dma_started[SIM_TX_CHANNEL] && _is_dma_started[SIM_RX_CHANNEL])
+    {
+        xDrvDmaTransfer_t tx = _dma[SIM_TX_CHANNEL];
+        xDrvDmaTransfer_t rx = _dma[SIM_RX_CHANNEL];
+
+        CHECK(tx.count == rx.count);
+        CHECK(tx.direction == DD_DIR_MEM_TO_PERIPH && rx.direction == DD_DIR_PERIPH_TO_MEM);
+
+        for (uint16_t i = 0; i < tx.count; i++)
+        {
+            ((uint8_t *)rx.mem_addr)[i] = _sim_echo(((uint8_t *)tx.mem_addr)[i]);
+        }
+
+        _is_dma_started[SIM_TX_CHANNEL] = FALSE;
+        _is_dma_started[SIM_RX_CHANNEL] = FALSE;
+        _dma_blocks++;
+
+        if (rx.callback)
+        {
+            rx.callback(rx.callback_arg, RESULT_OK);
+        }
+    }
+}
+
+result_t drv_usart_init_port(xDrvUsartPortParams_t * port_params)
+{
+    _brr = port_params->baudrate;
+    _stop_bits = port_params->stop_bits;
+
+    return RESULT_OK;
+}
+
+uint32_t drv_usart_calculate_brr(eDrvUsartNum_t usart_no, uint32_t baudrate)
+{
+    (void)usart_no;
+
+    return baudrate;
+}
+
+void drv_usart_set_brr(eDrvUsartNum_t usart_no, uint32_t brr)
+{
+    (void)usart_no;
+
+    _brr = brr;
+}
+
+void drv_usart_set_stop_bits(eDrvUsartNum_t usart_no, eDrvUsartStopBits_t stop_bits)
+{
+    (void)usart_no;
+
+    _stop_bits = stop_bits;
+}
+
+void drv_usart_putc(eDrvUsartNum_t usart_no, uint8_t ch)
+{
+    (void)usart_no;
+
+    _rx = _sim_echo(ch);
+    _is_rx = TRUE;
+}
+
+result_t drv_usart_getc(eDrvUsartNum_t usart_no, uint8_t * ch)
+{
+    (void)usart_no;
+
+    if (!_is_rx)
+    {
+        return RESULT_NOTHING;
+    }
+
+    *ch = _rx;
+    _is_rx = FALSE;
+
+    return RESULT_OK;
+}
+
+uint32_t drv_usart_take_rx_errors(eDrvUsartNum_t usart_no)
+{
+    uint32_t errors = _rx_errors;
+
+    (void)usart_no;
+    _rx_errors = 0;
+
+    return errors;
+}
+
+volatile void * drv_usart_get_dr_address(eDrvUsartNum_t usart_no)
+{
+    static uint32_t dr;
+
+    (void)usart_no;
+
+    return &dr;
+}
+
+void drv_usart_get_dma_channels(eDrvUsartNum_t usart_no, eDrvDmaChannel_t * tx_channel, eDrvDmaChannel_t * rx_channel)
+{
+    (void)usart_no;
+
+    *tx_channel = SIM_TX_CHANNEL;
+    *rx_channel = SIM_RX_CHANNEL;
+}
+
+void drv_usart_set_dma(eDrvUsartNum_t usart_no, BOOL is_enabled)
+{
+    (void)usart_no;
+
+    _is_dma = is_enabled;
+}
+
+result_t drv_dma_start(eDrvDmaChannel_t channel, xDrvDmaTransfer_t * transfer)
+{
+    _dma[channel] = *transfer;
+    _is_dma_started[channel] = TRUE;
+
+    return RESULT_OK;
+}
+
+void drv_dma_stop(eDrvDmaChannel_t channel)
+{
+    _is_dma_started[channel] = FALSE;
+}
+
+/**
+ * @brief Encode the slots of a Match ROM read transaction, feed back the
+ *      echoes and check the bits and bytes on both sides
+ */
+static void _test_encode_decode(void)
+{
+    uint8_t const rom[ONE_WIRE_ROM_SIZE] = {0x28, 0xA1, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    uint8_t const reply[2] = {0xA5, 0x3C};
+    uint8_t header[ONE_WIRE_HEADER_MAX];
+    uint8_t slots[128];
+    uint8_t echoes[128];
+    uint8_t rx[2];
+    xDrvOneWireCursor_t cursor;
+    uint16_t count;
+
+    xDrvOneWireTransaction_t transaction = {
+        .is_reset = TRUE,
+        .rom_command = 0x55,
+        .rom = rom,
+        .command = 0xBE,
+        .rx = rx,
+        .rx_length = sizeof(rx)
+    };
+
+    header[0] = 0x55;
+    memcpy(&header[1], rom, sizeof(rom));
+    header[1 + ONE_WIRE_ROM_SIZE] = 0xBE;
+
+    drv_one_wire_cursor_init(&cursor, &transaction);
+
+    // Reset pulse goes alone
+    count = drv_one_wire_usart_encode_slots(&cursor, slots, sizeof(slots));
+    CHECK(count == 1 && slots[0] == ONE_WIRE_RESET_PULSE);
+    echoes[0] = SIM_PRESENCE_ECHO;
+    CHECK(drv_one_wire_usart_decode_slots(&cursor, slots, echoes, count) == RESULT_NOTHING);
+
+    // Header and read slots up to the buffer size, one byte per bit, LSB first
+    count = drv_one_wire_usart_encode_slots(&cursor, slots, 40);
+    CHECK(count == 40);
+    count += drv_one_wire_usart_encode_slots(&cursor, &slots[40], sizeof(slots) - 40);
+    CHECK(count == (ONE_WIRE_HEADER_MAX + sizeof(rx)) * 8);
+
+    for (uint16_t i = 0; i < ONE_WIRE_HEADER_MAX * 8; i++)
+    {
+        CHECK(slots[i] == (_bit(header, i) ? ONE_WIRE_SLOT_ONE : ONE_WIRE_SLOT_ZERO));
+        echoes[i] = slots[i];
+    }
+
+    for (uint16_t i = 0; i < sizeof(rx) * 8; i++)
+    {
+        uint16_t slot = ONE_WIRE_HEADER_MAX * 8 + i;
+
+        CHECK(slots[slot] == ONE_WIRE_SLOT_ONE);
+        echoes[slot] = _bit(reply, i) ? ONE_WIRE_SLOT_ONE : SIM_READ_0_ECHO;
+    }
+
+    CHECK(drv_one_wire_usart_encode_slots(&cursor, slots, sizeof(slots)) == 0);
+    CHECK(drv_one_wire_usart_decode_slots(&cursor, &slots[0], &echoes[0], 40) == RESULT_NOTHING);
+    CHECK(drv_one_wire_usart_decode_slots(&cursor, &slots[40], &echoes[40], count - 40) == RESULT_OK);
+    CHECK(!memcmp(rx, reply, sizeof(reply)));
+
+    // Full length reset pulse echo: nobody answered
+    drv_one_wire_cursor_init(&cursor, &transaction);
+    count = drv_one_wire_usart_encode_slots(&cursor, slots, sizeof(slots));
+    echoes[0] = ONE_WIRE_RESET_PULSE;
+    CHECK(drv_one_wire_usart_decode_slots(&cursor, slots, echoes, count) == RESULT_NO_DEVICE);
+}
+
+/**
+ * @brief Build Convert T and Match ROM Read Scratchpad chained after it
+ * 
+ * @param first[out] Convert T transaction
+ * @param second[out] Read Scratchpad transaction
+ * @param rom The ROM to match
+ * @param rx Place for 9 scratchpad bytes
+ */
+static void _make_chain(xDrvOneWireTransaction_t * first, xDrvOneWireTransaction_t * second, uint8_t const * rom, uint8_t * rx)
+{
+    memset(first, 0, sizeof(*first));
+    memset(second, 0, sizeof(*second));
+
+    first->is_reset = TRUE;
+    first->rom_command = 0xCC;
+    first->command = 0x44;
+    first->next = second;
+
+    second->is_reset = TRUE;
+    second->rom_command = 0x55;
+    second->rom = rom;
+    second->command = 0xBE;
+    second->rx = rx;
+    second->rx_length = 9;
+}
+
+/**
+ * @brief Run the chain polled, as before the scheduler starts, and with DMA,
+ *      where the whole chain must take one task wake
+ */
+static void _test_chain(void)
+{
+    xDrvOneWireUsart_t ow = DRV_ONE_WIRE_USART(DU_USART2);
+    xDrvOneWireBus_t bus = {.ops = &drv_one_wire_usart_ops, .hw = &ow};
+    uint8_t const rom[ONE_WIRE_ROM_SIZE] = {0x28, 0xA1, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    uint8_t const scratch[9] = {0x91, 0x01, 0x4B, 0x46, 0x7F, 0xFF, 0x0F, 0x10, 0x8D};
+    xDrvOneWireTransaction_t first, second;
+    uint8_t rx[9];
+
+    for (uint8_t is_dma = 0; is_dma < 2; is_dma++)
+    {
+        host_scheduler_state = is_dma ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+        memset(rx, 0, sizeof(rx));
+        _make_chain(&first, &second, rom, rx);
+        _sim_reset(TRUE);
+        _sim_reply(scratch, sizeof(scratch), (2 + ONE_WIRE_HEADER_MAX) * 8);
+
+        CHECK(drv_one_wire_transaction(&bus, &first) == RESULT_OK);
+        CHECK(_device.resets == 2 && _device.received_bits == (2 + ONE_WIRE_HEADER_MAX) * 8);
+        CHECK(_device.received[0] == 0xCC && _device.received[1] == 0x44 && _device.received[2] == 0x55);
+        CHECK(!memcmp(&_device.received[3], rom, sizeof(rom)));
+        CHECK(!memcmp(rx, scratch, sizeof(scratch)));
+        CHECK(_baud_errors == 0);
+        CHECK(_waits == (is_dma ? 1 : 0));
+        CHECK(!is_dma || _dma_blocks > 4);
+        CHECK(!_is_dma && _brr == ONE_WIRE_SLOT_BAUDRATE);
+    }
+
+    host_scheduler_state = taskSCHEDULER_NOT_STARTED;
+}
+
+/**
+ * @brief Framing error at any slot fails the transaction with
+ *      RESULT_BUS_ERROR, missing presence with RESULT_NO_DEVICE and DMA that
+ *      never completes with RESULT_TIMEOUT
+ */
+static void _test_errors(void)
+{
+    xDrvOneWireUsart_t ow = DRV_ONE_WIRE_USART(DU_USART2);
+    xDrvOneWireBus_t bus = {.ops = &drv_one_wire_usart_ops, .hw = &ow};
+    uint8_t const rom[ONE_WIRE_ROM_SIZE] = {0x28, 0xA1, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    xDrvOneWireTransaction_t first, second;
+    uint8_t rx[9];
+
+    for (uint8_t is_dma = 0; is_dma < 2; is_dma++)
+    {
+        host_scheduler_state = is_dma ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+
+        // Reset pulse, a header slot and a read slot
+        uint16_t const framing_errors_at[] = {0, 5, 3 + 2 * 8 + ONE_WIRE_HEADER_MAX * 8 + 20};
+        for (uint8_t i = 0; i < ARRAY_SIZE(framing_errors_at); i++)
+        {
+            _make_chain(&first, &second, rom, rx);
+            _sim_reset(TRUE);
+            _framing_error_at = framing_errors_at[i];
+            CHECK(drv_one_wire_transaction(&bus, &first) == RESULT_BUS_ERROR);
+            CHECK(bus.stats.framing_errors == i + 1 + is_dma * ARRAY_SIZE(framing_errors_at));
+        }
+
+        _make_chain(&first, &second, rom, rx);
+        _sim_reset(FALSE);
+        CHECK(drv_one_wire_transaction(&bus, &first) == RESULT_NO_DEVICE);
+        CHECK(_bytes == 1);
+    }
+
+    _make_chain(&first, &second, rom, rx);
+    _sim_reset(TRUE);
+    _is_stuck = TRUE;
+    CHECK(drv_one_wire_transaction(&bus, &first) == RESULT_TIMEOUT);
+    CHECK(!_is_dma && !_is_dma_started[SIM_TX_CHANNEL] && !_is_dma_started[SIM_RX_CHANNEL]);
+
+    host_scheduler_state = taskSCHEDULER_NOT_STARTED;
+}
+
+/**
+ * @brief Overdrive runs the chain at overdrive baudrates with two stop bits,
+ *      standard speed returns to one
+ */
+static void _test_overdrive(void)
+{
+    xDrvOneWireUsart_t ow = DRV_ONE_WIRE_USART(DU_USART2);
+    xDrvOneWireBus_t bus = {.ops = &drv_one_wire_usart_ops, .hw = &ow};
+    uint8_t const rom[ONE_WIRE_ROM_SIZE] = {0x28, 0xA1, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    xDrvOneWireTransaction_t first, second;
+    uint8_t rx[9];
+
+    host_scheduler_state = taskSCHEDULER_RUNNING;
+    _make_chain(&first, &second, rom, rx);
+    _sim_reset(TRUE);
+
+    CHECK(drv_one_wire_set_speed(&bus, DOW_SPEED_OVERDRIVE) == RESULT_OK);
+    CHECK(_stop_bits == DU_STOP_BITS_2 && _brr == ONE_WIRE_OD_SLOT_BAUDRATE);
+    CHECK(drv_one_wire_transaction(&bus, &first) == RESULT_OK);
+    CHECK(_device.resets == 2 && _baud_errors == 0 && _recovery_errors == 0);
+    CHECK(_brr == ONE_WIRE_OD_SLOT_BAUDRATE);
+
+    CHECK(drv_one_wire_set_speed(&bus, DOW_SPEED_STANDARD) == RESULT_OK);
+    CHECK(_stop_bits == DU_STOP_BITS_1 && _brr == ONE_WIRE_SLOT_BAUDRATE);
+
+    host_scheduler_state = taskSCHEDULER_NOT_STARTED;
+}
+
+int main(void)
+{
+    host_run_hardware = _sim_dma;
+
+    _test_encode_decode();
+    _test_chain();
+    _test_errors();
+    _test_overdrive();
+
+    if (host_failures)
+    {
+        fprintf(stderr, "%u checks failed\n", host_failures);
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file